@@ -0,0 +1,310 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include "fhn.hpp"
+
+
+// ---------------------------------------------------------------------------------
+// ----------------------------------- ALLOCATIONS ---------------------------------
+// ---------------------------------------------------------------------------------
+
+std::atomic<long> allocationCount( 0 );   // number of calls of the global operator new (also used by new[]) so far
+
+void* operator new( std::size_t size )
+{
+  allocationCount++;
+  void* p( std::malloc( size ? size : 1 ) );
+  if( !p )
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete( void* p ) noexcept
+{
+  std::free( p );
+}
+
+
+// ---------------------------------------------------------------------------------
+// ----------------------------------- BENCHMARKS ----------------------------------
+// ---------------------------------------------------------------------------------
+
+// Microbenchmarks of the stages of FhnVerifyExistenceOfPeriodicOrbit for theta = 0.61, eps in [0,1e-6], one CSV line per measurement:
+// stage, variant, discretization (disc, or 0 if the stage has none), threads, repetitions, seconds (of the fastest repetition), evaluations (units of work
+// of one repetition: corrections, coordinate changes, integrated cells, face products or calls), evaluations per second, heap allocations of the last repetition
+// and the result ("ok" or the message of the check which failed). The columns and the order of lines do not change between runs with the same options,
+// so outputs of different versions can be compared line by line.
+
+class FhnBenchReport
+{
+public:
+  std::ostream& output;
+  int repetitions;
+
+  FhnBenchReport( std::ostream& _output, int _repetitions ) : output( _output ), repetitions( _repetitions > 0 ? _repetitions : 1 )
+  {
+    output.precision(9);
+    output << "stage,variant,disc,threads,repetitions,seconds,evaluations,evaluations_per_second,allocations,result\n";
+  }
+
+  template<typename Task>
+  void measure( const std::string& stage, const std::string& variant, int disc, int threads, Task task ) // task() runs the stage once and returns its number of evaluations
+  {
+    double best( 0. );
+    long evaluations( 0 ), allocations( 0 );
+    std::string result( "ok" );
+
+    for( int r = 0; r < repetitions; r++ )
+    {
+      long allocationsBefore( allocationCount );
+      std::chrono::steady_clock::time_point start( std::chrono::steady_clock::now() );
+      try
+      {
+        evaluations = task();
+      }
+      catch(const char* Message)      // the time until the failed check is still reported
+      {
+        result = Message;
+        result = result.substr( 0, result.find( '!' ) );
+      }
+      double seconds( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+      allocations = allocationCount - allocationsBefore;
+      if( r == 0 || seconds < best )
+        best = seconds;
+    }
+
+    output << stage << "," << variant << "," << disc << "," << threads << "," << repetitions << "," << best << "," << evaluations << ","
+           << ( best > 0. ? evaluations/best : 0. ) << "," << allocations << "," << result << "\n";
+    output.flush();
+  }
+};
+
+std::vector<int> threadSteps( int _maxThreads ) // 1, 2, 4, ... up to _maxThreads (which is always included)
+{
+  std::vector<int> steps;
+  for( int t = 1; t < _maxThreads; t *= 2 )
+    steps.push_back( t );
+  steps.push_back( _maxThreads );
+  return steps;
+}
+
+void benchCornerSegment( FhnBenchReport& report, const char* name, FhnIsolatingSegment& segment, int disc, int refineDepth )
+  // face sweeps of a corner segment by the IMap, the hand-written vector field cell by cell, the hand-written vector field a face row at a time and by adaptive refinement
+{
+  std::string stage( std::string( "corner segment " ) + name );
+
+  segment.useKernel = 0;
+  report.measure( stage, "IMap", disc, 1, [&](){ segment.verifyFaces(); return segment.evaluationCount; } );
+
+  segment.useKernel = 1;
+  segment.useBatch = 0;
+  report.measure( stage, "kernel", disc, 1, [&](){ segment.verifyFaces(); return segment.evaluationCount; } );
+
+  segment.useBatch = 1;
+  report.measure( stage, "batched kernel", disc, 1, [&](){ segment.verifyFaces(); return segment.evaluationCount; } );
+
+  segment.refineDepth = refineDepth;
+  report.measure( stage, "refinement depth " + std::to_string( refineDepth ), disc, 1, [&](){ segment.verifyFaces(); return segment.evaluationCount; } );
+  segment.refineDepth = 0;
+}
+
+
+// ---------------------------------------------------------------------------------
+// ----------------------------------- MAIN ----------------------------------------
+// ---------------------------------------------------------------------------------
+
+const char* usage =
+  "usage: bench [options]\n"
+  "  --output FILE       results in CSV format (default bench.csv)\n"
+  "  --max-threads N     thread counts 1, 2, 4, ..., N for the scaling curves (default 0 - all cores)\n"
+  "  --repetitions N     repetitions of every measurement, the fastest one is reported (default 1)\n"
+  "  --no-proof          skip the whole proof\n";
+
+int main( int argc, char* argv[] ){
+
+  cout.precision(9);
+
+  const char* outputFile( "bench.csv" );
+  int maxThreads( 0 ), repetitions( 1 );
+  bool wholeProof( 1 );
+
+  for( int k = 1; k < argc; k++ )
+  {
+    bool hasValue( k + 1 < argc );
+
+    if( !std::strcmp( argv[k], "--output" ) && hasValue )
+      outputFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--max-threads" ) && hasValue )
+      maxThreads = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--repetitions" ) && hasValue )
+      repetitions = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--no-proof" ) )
+      wholeProof = 0;
+    else
+    {
+      std::cerr << usage;
+      return 1;
+    }
+  }
+
+  std::ofstream output( outputFile );
+  if( !output )
+  {
+    std::cerr << "Cannot write to " << outputFile << "\n";
+    return 1;
+  }
+  FhnBenchReport report( output, repetitions );
+  std::vector<int> threads( threadSteps( threadCount( maxThreads ) ) );
+
+  interval theta = interval(61.)/100.;
+  interval eps = interval(0.,1.)/1e6;
+  int cornerSegmentDivCount = 200;
+  int faceRefineDepth = 5;
+  int longSubsegmentCount = 100;
+  int longSegmentDivCount = 80;
+  int pMapDivCounts[3] = { 5, 10, 20 };
+
+  IMap vectorField( Fhn_vf ), vectorFieldRev( Fhn_vf_rev );
+  vectorField.setParameter("theta",theta);
+  vectorField.setParameter("eps",eps);
+  vectorFieldRev.setParameter("theta",theta);
+  vectorFieldRev.setParameter("eps",eps);
+
+  if( !FhnVectorFieldSelfTest( vectorField ) )
+  {
+    std::cerr << "SELF-TEST OF THE HAND-WRITTEN VECTOR FIELD FAILED! \n";
+    return 1;
+  }
+
+  // corner points and coordinate changes
+
+  IVector GammaUL(3), GammaDL(3), GammaUR(3), GammaDR(3);
+
+  FhnBifurcation::RootFinder rootFinders[2] = { FhnBifurcation::SECANT, FhnBifurcation::ILLINOIS };
+  const char* rootFinderNames[2] = { "secant", "illinois" };
+  for( int m = 0; m < 2; m++ )
+    report.measure( "GammaQuad_correct", rootFinderNames[m], 0, 1, [&]()
+    {
+      GammaUL = IVector(0.970345591417269, 0., 0.0250442158334208);     // the original guesses of FhnCornerPoints
+      GammaDL = IVector(-0.108412947498862, 0., 0.0250442158334208);
+      GammaUR = IVector(0.841746280832201, 0., 0.0988076360184288);
+      GammaDR = IVector(-0.237012258083933, 0., 0.0988076360184288);
+      GammaQuad_correct( theta, GammaUL, GammaDL, GammaUR, GammaDR, rootFinders[m] );
+      return 1L;
+    } );
+
+  IMatrix PUL(3,3), PUR(3,3), PDL(3,3), PDR(3,3);
+  report.measure( "coordChange", "corner points", 0, 1, [&]()
+  {
+    PUL = coordChange( vectorField, GammaUL );
+    PUR = coordChange( vectorField, GammaUR );
+    PDL = coordChange( vectorField, GammaDL );
+    PDR = coordChange( vectorField, GammaDR );
+    return 4L;
+  } );
+
+  // the left Poincare map of the proof (3d version) and its midsection variant
+
+  interval ruDL(0.011), rsUL(0.01), ruUR(0.0015);
+  IVector setToIntegrateDL({ 1.0e-3*interval(-1,1), 1.0e-3*interval(-1,1) });
+  IVector setToBackIntegrateUL({ 0.4*1.0e-3*interval(-1,1), 1.0e-3*interval(-1,1) });
+
+  for( int d = 0; d < 3; d++ )
+    for( unsigned int t = 0; t < threads.size(); t++ )
+    {
+      FhnPoincareMap PMAPL( vectorField, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., pMapDivCounts[d], threads[t] );
+      report.measure( "FhnPoincareMap", "uniform", pMapDivCounts[d], threads[t], [&]()
+      {
+        PMAPL( setToIntegrateDL );
+        return long( PMAPL.cellCount );
+      } );
+    }
+
+  for( int d = 0; d < 3; d++ )
+    for( unsigned int t = 0; t < threads.size(); t++ )
+    {
+      midPoincareMap midMap( vectorField, vectorFieldRev, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., pMapDivCounts[d], threads[t] );
+      report.measure( "midPoincareMap::checkCovering", "uniform", pMapDivCounts[d], threads[t], [&]()
+      {
+        midMap.checkCovering( setToIntegrateDL, setToBackIntegrateUL );
+        return 1L;
+      } );
+    }
+
+  // the DL and UR corner segments as in FhnVerifyExistenceOfPeriodicOrbit (these do not depend on the Poincare maps)
+
+  IVector setToIntegrateUR({ 1.0e-3*interval(-1,1), 1.0e-4*interval(-1,1) });
+
+  IVector DLface( setToIntegrateDL[0], ruDL*interval(-1,1), 0. );
+  IVector URface( setToIntegrateUR[0], ruUR*interval(-1,1), 0. );
+
+  FhnIsolatingSegment DLSegment( vectorField, GammaDL + IVector( 0., 0., setToIntegrateDL[1].leftBound() ),
+      GammaDL + IVector( 0., 0., setToIntegrateDL[1].rightBound() ), PDL, DLface, DLface, cornerSegmentDivCount );
+  FhnIsolatingSegment URSegment( vectorField, GammaUR + IVector( 0., 0., setToIntegrateUR[1].leftBound() ),
+      GammaUR + IVector( 0.,0.,setToIntegrateUR[1].rightBound() ), PUR, URface, URface, cornerSegmentDivCount );
+
+  benchCornerSegment( report, "DL", DLSegment, cornerSegmentDivCount, faceRefineDepth );
+  benchCornerSegment( report, "UR", URSegment, cornerSegmentDivCount, faceRefineDepth );
+
+  // the lower long segment, with the face of the DL segment on both ends instead of the one given by the right Poincare map
+
+  longIsolatingSegment pointSegment( vectorField, dynamicVector( DLSegment.GammaRight ), GammaDR + IVector( 0., 0., -1.0e-3 ), PDL, PDR, DLface, DLface, longSegmentDivCount );
+  int pointCounts[2] = { longSubsegmentCount, 100*longSubsegmentCount };
+  for( int c = 0; c < 2; c++ )
+    report.measure( "slowManifoldPoints", std::to_string( pointCounts[c] ) + " subsegments", 0, 1, [&]()
+    {
+      return long( pointSegment.slowManifoldPoints( pointCounts[c] ).size() );
+    } );
+
+  // coordinate changes along the lower branch, one per subsegment
+
+  std::vector<IVector> framePoints( pointSegment.slowManifoldPoints( longSubsegmentCount ) );
+  report.measure( "coordChange", std::to_string( longSubsegmentCount ) + " subsegments", 0, 1, [&]()
+  {
+    for( size_t k = 0; k < framePoints.size(); k++ )
+      coordChange( vectorField, framePoints[k] );
+    return long( framePoints.size() );
+  } );
+
+  for( unsigned int t = 0; t < threads.size(); t++ )
+  {
+    longIsolatingSegment DownSegment( vectorField, dynamicVector( DLSegment.GammaRight ), GammaDR + IVector( 0., 0., -1.0e-3 ), PDL, PDR, DLface, DLface,
+                                      longSegmentDivCount, threads[t] );
+    report.measure( "longIsolatingSegment", std::to_string( longSubsegmentCount ) + " subsegments", longSegmentDivCount, threads[t], [&]()
+    {
+      DownSegment.entranceAndExitVerification( longSubsegmentCount );
+      return DownSegment.evaluationCount;
+    } );
+  }
+
+  // the whole proof, compare the outputs of bench and bench_static (built with FHN_STATIC_DIMENSION, see segments.hpp)
+
+  if( wholeProof )
+  {
+#ifdef FHN_STATIC_DIMENSION
+    const char* segmentVectors( "fixed-size segment vectors" );
+#else
+    const char* segmentVectors( "dynamic segment vectors" );
+#endif
+    std::string failedCheck;      // outlives the verification result, so that it can be thrown to measure
+    for( unsigned int t = 0; t < threads.size(); t++ )
+    {
+      FhnProofSettings proofSettings;
+      proofSettings.threadCount = threads[t];
+      report.measure( "FhnVerifyExistenceOfPeriodicOrbit", segmentVectors, 0, threads[t], [&]()
+      {
+        FhnVerificationResult proof( FhnVerifyExistenceOfPeriodicOrbit( theta, eps, 0, 0, 20, longSubsegmentCount, longSegmentDivCount, cornerSegmentDivCount, proofSettings ) );
+        if( !proof.verified )
+        {
+          failedCheck = proof.failedCheck;
+          throw failedCheck.c_str();
+        }
+        return 1L;
+      } );
+    }
+  }
+
+  return 0;
+}
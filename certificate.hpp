@@ -0,0 +1,298 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing certificates of verifications: the checked enclosures
+ * of the images of the Poincare maps and of the products of the vector field with face normals on every
+ * face box of every segment and subsegment are streamed to a binary file of fixed size records as the proof runs
+ * (checks on the geometry, i.e. coverings between subsegments and the alignment of segments, have no records).
+ * Segments collect their records in small buffers of their own and hand them to the writer a block
+ * at a time, the writer appends them to a buffered file, so memory does not grow with the number of
+ * boxes and no text is formatted. Records of concurrent verifications (e.g. of a sweep) are interleaved,
+ * each carries the number of its verification (run). fhn-cert reads the file back and checks it.
+ * The geometry of all verified segments and the coverings between subsegments are written to a second,
+ * text file (one line each, all bounds in full precision), from which fhn-check verifies the faces again.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- CERTIFICATE RECORDS ----------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+struct FhnCertificateRecord       // 40 bytes, the layout of the file
+{
+  enum Stage
+  {
+    PARAMETERS,                   // face 0 - theta, face 1 - eps, the first records of every run
+    RESULT,                       // face 1 - verified, 0 - not verified, the last record of every run
+    LEFT_POINCARE_MAP,            // face 0, 1, 2 - image of the left unstable edge, the right unstable edge, the whole exit face, i - coordinate
+    RIGHT_POINCARE_MAP,
+    UL_SEGMENT,                   // corner segments, face - SL, SR, UL, UR (see FhnIsolatingSegmentT::Face), i, j - face box
+    DL_SEGMENT,
+    UR_SEGMENT,
+    DR_SEGMENT,
+    UP_SEGMENTS,                  // subsegments of long segments, in addition with the index of the subsegment
+    DOWN_SEGMENTS,
+    STAGE_COUNT
+  };
+
+  uint32_t run;
+  uint16_t stage;
+  uint16_t face;
+  int32_t subsegment;             // -1 unless a subsegment of a long segment
+  int32_t cells;                  // face boxes are [i-1,i]/cells x [j-1,j]/cells fractions of the slow variable and of the face (0 - not a face box),
+                                  // bisected boxes are fractions of the face row of their coarse box (see refineFaceProduct)
+  int32_t i;
+  int32_t j;
+  double lo;                      // bounds of the enclosure
+  double hi;
+};
+
+struct FhnCertificateHeader
+{
+  char magic[8];
+  unsigned int version;
+  unsigned int recordSize;
+};
+
+const unsigned int FhnCertificateVersion = 1;
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- SEGMENT GEOMETRY -------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+// lines of the geometry file:
+//   segment RUN STAGE SUBSEGMENT DISC REFINEDEPTH theta eps GammaLeft GammaRight P leftFace rightFace
+//   covering RUN STAGE SUBSEGMENT Face_i0 P_i0 P_i1 Face_i0_adj
+//   result RUN VERIFIED SUBSEGMENTS       (the last line of every run, SUBSEGMENTS - number of subsegments of each long segment)
+// where vectors and matrices (3x3, by rows) are lists of lower and upper bounds of their coordinates
+
+template<typename VectorType>
+void FhnWriteVector( std::ostream& line, const VectorType& x )
+{
+  for( int k = 0; k < int( x.dimension() ); k++ )
+    line << " " << x[k].leftBound() << " " << x[k].rightBound();
+}
+
+template<typename MatrixType>
+void FhnWriteMatrix( std::ostream& line, const MatrixType& A )
+{
+  for( int i = 0; i < int( A.numberOfRows() ); i++ )
+    for( int j = 0; j < int( A.numberOfColumns() ); j++ )
+      line << " " << A[i][j].leftBound() << " " << A[i][j].rightBound();
+}
+
+IVector FhnReadVector( std::istream& line, int dimension )
+{
+  IVector x( dimension );
+  for( int k = 0; k < dimension; k++ )
+  {
+    double lo, hi;
+    line >> lo >> hi;
+    x[k] = interval( lo, hi );
+  }
+  return x;
+}
+
+IMatrix FhnReadMatrix( std::istream& line, int rows, int columns )
+{
+  IMatrix A( rows, columns );
+  for( int i = 0; i < rows; i++ )
+    for( int j = 0; j < columns; j++ )
+    {
+      double lo, hi;
+      line >> lo >> hi;
+      A[i][j] = interval( lo, hi );
+    }
+  return A;
+}
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- CERTIFICATE WRITER ------------------------------------ */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnCertificateWriter       // shared by all verifications writing to one file
+{
+public:
+  std::FILE* output;
+  std::FILE* geometry;           // the geometry file, path of the certificate with .geometry appended
+  std::vector<char> fileBuffer;
+  std::atomic<uint32_t> runCount;
+  std::mutex mutex;
+
+  FhnCertificateWriter( const std::string& path ) 
+    : output( std::fopen( path.c_str(), "wb" ) ), geometry( std::fopen( ( path + ".geometry" ).c_str(), "w" ) ), fileBuffer( 1 << 20 ), runCount( 0 )
+  {
+    if( !output || !geometry )
+    {
+      if( output )
+        std::fclose( output );
+      if( geometry )
+        std::fclose( geometry );
+      throw "CANNOT WRITE THE CERTIFICATE! \n";
+    }
+    std::setvbuf( output, fileBuffer.data(), _IOFBF, fileBuffer.size() );
+
+    FhnCertificateHeader header;
+    std::memcpy( header.magic, "FHNCERT", 8 );
+    header.version = FhnCertificateVersion;
+    header.recordSize = sizeof(FhnCertificateRecord);
+    std::fwrite( &header, sizeof(header), 1, output );
+  }
+
+  ~FhnCertificateWriter()
+  {
+    std::fclose( output );
+    std::fclose( geometry );
+  }
+
+  void writeGeometry( const std::string& line ) // one line of the geometry file (see above)
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    std::fputs( line.c_str(), geometry );
+    std::fputc( '\n', geometry );
+  }
+
+  void write( const FhnCertificateRecord* records, size_t count )
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    std::fwrite( records, sizeof(FhnCertificateRecord), count, output );
+  }
+
+  uint32_t beginRun( const interval& theta, const interval& eps ) // returns the number of the new run
+  {
+    uint32_t run( runCount++ );
+    FhnCertificateRecord records[2] = { { run, FhnCertificateRecord::PARAMETERS, 0, -1, 0, 0, 0, theta.leftBound(), theta.rightBound() },
+                                        { run, FhnCertificateRecord::PARAMETERS, 1, -1, 0, 0, 0, eps.leftBound(), eps.rightBound() } };
+    write( records, 2 );
+    return run;
+  }
+
+  void endRun( uint32_t run, bool verified, int subsegments ) // subsegments of each long segment, so that fhn-check knows all segments and coverings of the run
+  {
+    FhnCertificateRecord record = { run, FhnCertificateRecord::RESULT, uint16_t( verified ), -1, 0, 0, 0, 0., 0. };
+    std::lock_guard<std::mutex> lock( mutex );
+    std::fwrite( &record, sizeof(record), 1, output );
+    std::fprintf( geometry, "result %u %d %d\n", run, int( verified ), subsegments );
+    std::fflush( output );   // a finished run is complete in the files
+    std::fflush( geometry );
+  }
+};
+
+class FhnCertificateStream       // records of one stage (or subsegment) of one run, buffered and written to the writer a block at a time
+{
+public:
+  static const size_t blockSize = 4096;
+
+  FhnCertificateWriter* writer;  // 0 - no certificate, nothing is recorded
+  uint32_t run;
+  uint16_t stage;
+  int32_t subsegment;
+  std::vector<FhnCertificateRecord> buffer;
+
+  FhnCertificateStream( FhnCertificateWriter* _writer = 0, uint32_t _run = 0, int _stage = 0, int _subsegment = -1 )
+    : writer( _writer ), run( _run ), stage( _stage ), subsegment( _subsegment )
+  {
+  }
+
+  FhnCertificateStream( const FhnCertificateStream& other )   // copies where the records go, not the records
+    : writer( other.writer ), run( other.run ), stage( other.stage ), subsegment( other.subsegment )
+  {
+  }
+
+  FhnCertificateStream& operator=( const FhnCertificateStream& other )
+  {
+    flush();
+    writer = other.writer;
+    run = other.run;
+    stage = other.stage;
+    subsegment = other.subsegment;
+    return *this;
+  }
+
+  ~FhnCertificateStream()
+  {
+    flush();
+  }
+
+  void add( int face, int cells, int i, int j, const interval& x )
+  {
+    if( buffer.empty() )
+      buffer.reserve( blockSize );
+    FhnCertificateRecord record = { run, stage, uint16_t( face ), subsegment, cells, i, j, x.leftBound(), x.rightBound() };
+    buffer.push_back( record );
+    if( buffer.size() == blockSize )
+      flush();
+  }
+
+  void faceBox( int face, const interval& ti, const interval& tj, const interval& product ) // the box [ti] x [tj] of a uniform or bisected grid
+  {
+    int cells( int( 1./( ti.rightBound() - ti.leftBound() ) + 0.5 ) );
+    add( face, cells, int( ( ti.leftBound() + ti.rightBound() )/2.*cells ) + 1, int( ( tj.leftBound() + tj.rightBound() )/2.*cells ) + 1, product );
+  }
+
+  void image( int item, const IVector& x ) // all coordinates of an image of a Poincare map
+  {
+    for( int k = 0; k < x.dimension(); k++ )
+      add( item, 0, k, 0, x[k] );
+  }
+
+  void flush()
+  {
+    if( writer && !buffer.empty() )
+      writer->write( buffer.data(), buffer.size() );
+    buffer.clear();
+  }
+};
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- CERTIFICATE READER ------------------------------------ */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnCertificateReader
+{
+public:
+  std::FILE* input;
+  std::vector<FhnCertificateRecord> block;
+  size_t position;
+  size_t count;
+
+  FhnCertificateReader( const std::string& path ) : input( std::fopen( path.c_str(), "rb" ) ), block( 1 << 16 ), position( 0 ), count( 0 )
+  {
+    FhnCertificateHeader header;
+    if( !input || std::fread( &header, sizeof(header), 1, input ) != 1 || std::memcmp( header.magic, "FHNCERT", 8 ) != 0
+        || header.version != FhnCertificateVersion || header.recordSize != sizeof(FhnCertificateRecord) )
+    {
+      if( input )
+        std::fclose( input );
+      throw "NOT A CERTIFICATE OF THIS VERSION! \n";
+    }
+  }
+
+  ~FhnCertificateReader()
+  {
+    std::fclose( input );
+  }
+
+  bool next( FhnCertificateRecord& record ) // returns 0 at the end of the file (an incomplete last record is ignored)
+  {
+    if( position == count )
+    {
+      count = std::fread( block.data(), sizeof(FhnCertificateRecord), block.size(), input );
+      position = 0;
+      if( count == 0 )
+        return 0;
+    }
+    record = block[position++];
+    return 1;
+  }
+};
@@ -0,0 +1,177 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing checkpoints of a verification: results of finished
+ * stages (images of Poincare maps, face products of corner segments and of each subsegment of long
+ * segments) are appended to a file as they finish, keyed by a hash of everything the stage verified
+ * (parameters, corner points, coordinate changes, faces, discretizations). A restarted verification
+ * with the same inputs finds them and skips that work; records of other inputs (e.g. of a changed
+ * discretization) are simply not found. The file is a header (magic, version) followed by records
+ * (key, number of doubles, doubles), an incomplete last record of an interrupted run is ignored.
+ * Only results which passed their checks are stored, so a resumed verification trusts the file
+ * as much as it trusts the run which wrote it. Keys also contain the time the program was compiled,
+ * so records of a program built before a check was changed are never found by the changed one.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <unistd.h>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- CHECKPOINTS ------------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnCheckpoint
+{
+public:
+  static const unsigned int version = 1;   // increase whenever a stage or the meaning of its record changes
+
+  class Hash             // 64-bit FNV-1a of the bit patterns of the inputs of a stage
+  {
+  public:
+    uint64_t value;
+
+    Hash( const char* stage ) : value( 14695981039346656037ULL ) { add( __DATE__ " " __TIME__ ).add( stage ); }   // the build of the program first
+
+    Hash& addBytes( const void* data, size_t size )
+    {
+      const unsigned char* bytes( static_cast<const unsigned char*>( data ) );
+      for( size_t k = 0; k < size; k++ )
+      {
+        value ^= bytes[k];
+        value *= 1099511628211ULL;
+      }
+      return *this;
+    }
+
+    Hash& add( const char* text ) { return addBytes( text, std::strlen( text ) + 1 ); }
+    Hash& add( int x ) { return addBytes( &x, sizeof(x) ); }
+    Hash& add( double x ) { return addBytes( &x, sizeof(x) ); }
+    Hash& add( const interval& x ) { return add( x.leftBound() ).add( x.rightBound() ); }
+
+    template<typename VectorType>
+    Hash& addVector( const VectorType& x )
+    {
+      add( int( x.dimension() ) );
+      for( int k = 0; k < int( x.dimension() ); k++ )
+        add( x[k] );
+      return *this;
+    }
+
+    template<typename MatrixType>
+    Hash& addMatrix( const MatrixType& A )
+    {
+      add( int( A.numberOfRows() ) ).add( int( A.numberOfColumns() ) );
+      for( int i = 0; i < int( A.numberOfRows() ); i++ )
+        for( int j = 0; j < int( A.numberOfColumns() ); j++ )
+          add( A[i][j] );
+      return *this;
+    }
+  };
+
+  struct Header
+  {
+    char magic[8];
+    unsigned int version;
+  };
+
+  std::string path;
+  std::map< uint64_t, std::vector<double> > records;
+  long validSize;        // size of the header and the complete records in the file
+  std::FILE* output;     // opened with the first store
+  std::mutex mutex;
+
+  FhnCheckpoint( const std::string& _path ) : path( _path ), validSize( 0 ), output( 0 )
+  {
+    std::FILE* input( std::fopen( path.c_str(), "rb" ) );
+    if( !input )
+      return;            // no checkpoint yet
+
+    Header header;
+    if( std::fread( &header, sizeof(Header), 1, input ) == 1 && std::memcmp( header.magic, "FHNCKPT", 8 ) == 0 && header.version == version )
+    {
+      validSize = sizeof(Header);
+      uint64_t key;
+      unsigned int count;
+      while( std::fread( &key, sizeof(key), 1, input ) == 1 && std::fread( &count, sizeof(count), 1, input ) == 1 )
+      {
+        std::vector<double> payload( count );
+        if( count > 0 && std::fread( payload.data(), sizeof(double), count, input ) != count )
+          break;
+        records[key] = payload;
+        validSize += sizeof(key) + sizeof(count) + count*sizeof(double);
+      }
+    }                    // otherwise validSize stays 0 and the file is rewritten with the first store
+    std::fclose( input );
+  }
+
+  ~FhnCheckpoint()
+  {
+    if( output )
+      std::fclose( output );
+  }
+
+  bool load( const Hash& key, std::vector<double>& payload ) // returns 0 if the stage with these inputs has not finished yet
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    std::map< uint64_t, std::vector<double> >::iterator found( records.find( key.value ) );
+    if( found == records.end() )
+      return 0;
+    payload = found->second;
+    return 1;
+  }
+
+  void store( const Hash& key, const std::vector<double>& payload )
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    records[key.value] = payload;
+
+    if( !output && !openOutput() )
+      return;            // the checkpoint still works in memory
+    unsigned int count( payload.size() );
+    std::fwrite( &key.value, sizeof(key.value), 1, output );
+    std::fwrite( &count, sizeof(count), 1, output );
+    std::fwrite( payload.data(), sizeof(double), count, output );
+    std::fflush( output );   // a record is complete once the stage has finished
+  }
+
+  bool openOutput()      // appends to the valid part of the file, or starts a new file
+  {
+    if( validSize > 0 )
+    {
+      if( ::truncate( path.c_str(), validSize ) != 0 )
+        return 0;
+      output = std::fopen( path.c_str(), "ab" );
+      return output != 0;
+    }
+
+    output = std::fopen( path.c_str(), "wb" );
+    if( !output )
+      return 0;
+    Header header;
+    std::memcpy( header.magic, "FHNCKPT", 8 );
+    header.version = version;
+    std::fwrite( &header, sizeof(Header), 1, output );
+    return 1;
+  }
+
+  static void append( std::vector<double>& payload, const IVector& x ) // dimension and bounds of all coordinates
+  {
+    payload.push_back( x.dimension() );
+    for( int k = 0; k < x.dimension(); k++ )
+    {
+      payload.push_back( x[k].leftBound() );
+      payload.push_back( x[k].rightBound() );
+    }
+  }
+
+  static IVector extract( const std::vector<double>& payload, size_t& position ) // the inverse of append, starting at position, which is moved past the vector
+  {
+    IVector x( int( payload[position++] ) );
+    for( int k = 0; k < x.dimension(); k++, position += 2 )
+      x[k] = interval( payload[position], payload[position+1] );
+    return x;
+  }
+};
@@ -0,0 +1,244 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing a batched evaluator of the products of the
+ * vector field with the outward normal of a face of an isolating segment over a whole row
+ * of face cells. Cells along the row only differ in one coordinate of the face, so it is
+ * laid out as structure-of-arrays lower and upper bounds and evaluated four cells at a time
+ * with AVX2 (or one at a time if the compiler does not target AVX2) by the same mean value form
+ * as FhnIsolatingSegment::kernelFaceProduct.
+ * Interval arithmetic is done by hand with directed rounding: the rounding mode is set upward
+ * and intervals are stored as (-lower bound, upper bound), so that both bounds are rounded
+ * outwards by the same upward operations. This requires compiling with -frounding-math.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <cfenv>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- DIRECTED ROUNDING ------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class RoundUpward    // sets the rounding mode upward for its lifetime, do not use CAPD intervals meanwhile
+{
+public:
+  int savedMode;
+
+  RoundUpward() : savedMode( std::fegetround() ) { std::fesetround( FE_UPWARD ); }
+  ~RoundUpward() { std::fesetround( savedMode ); }
+};
+
+struct BoundPair     // interval [-nlo, hi], negation of the lower bound is exact
+{
+  double nlo;
+  double hi;
+};
+
+BoundPair toBoundPair( const interval& x )
+{
+  BoundPair b = { -x.leftBound(), x.rightBound() };
+  return b;
+}
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- LANES ------------------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+struct ScalarLanes   // one cell at a time, also used for the tails of rows
+{
+  typedef double V;
+  static const int width = 1;
+
+  static V load( const double* p ) { return *p; }
+  static void store( double* p, V x ) { *p = x; }
+  static V set1( double x ) { return x; }
+  static V add( V a, V b ) { return a + b; }
+  static V mul( V a, V b ) { return a*b; }
+  static V neg( V a ) { return -a; }
+  static V max( V a, V b ) { return ( a > b ? a : b ); }
+  static V min( V a, V b ) { return ( a < b ? a : b ); }
+};
+
+#ifdef __AVX2__
+struct AvxLanes      // four cells at a time
+{
+  typedef __m256d V;
+  static const int width = 4;
+
+  static V load( const double* p ) { return _mm256_loadu_pd( p ); }
+  static void store( double* p, V x ) { _mm256_storeu_pd( p, x ); }
+  static V set1( double x ) { return _mm256_set1_pd( x ); }
+  static V add( V a, V b ) { return _mm256_add_pd( a, b ); }
+  static V mul( V a, V b ) { return _mm256_mul_pd( a, b ); }
+  static V neg( V a ) { return _mm256_xor_pd( a, _mm256_set1_pd( -0. ) ); }
+  static V max( V a, V b ) { return _mm256_max_pd( a, b ); }
+  static V min( V a, V b ) { return _mm256_min_pd( a, b ); }
+};
+#endif
+
+template<typename L>
+struct LaneInterval  // [-nlo, hi] in each lane, all operations assume upward rounding
+{
+  typename L::V nlo;
+  typename L::V hi;
+
+  LaneInterval() {}
+  LaneInterval( typename L::V _nlo, typename L::V _hi ) : nlo( _nlo ), hi( _hi ) {}
+  explicit LaneInterval( const BoundPair& b ) : nlo( L::set1( b.nlo ) ), hi( L::set1( b.hi ) ) {}
+
+  friend LaneInterval operator+( const LaneInterval& a, const LaneInterval& b )
+  {
+    return LaneInterval( L::add( a.nlo, b.nlo ), L::add( a.hi, b.hi ) );
+  }
+
+  friend LaneInterval operator-( const LaneInterval& a, const LaneInterval& b )
+  {
+    return LaneInterval( L::add( a.nlo, b.hi ), L::add( a.hi, b.nlo ) );
+  }
+
+  friend LaneInterval operator*( const LaneInterval& a, const LaneInterval& b )  // -(x*y) = (-x)*y is rounded upward for the lower bound
+  {
+    typename L::V al( L::neg( a.nlo ) ), nah( L::neg( a.hi ) ), bl( L::neg( b.nlo ) );
+
+    return LaneInterval( L::max( L::max( L::mul( a.nlo, bl ), L::mul( a.nlo, b.hi ) ), L::max( L::mul( nah, bl ), L::mul( nah, b.hi ) ) ),
+                         L::max( L::max( L::mul( al, bl ), L::mul( al, b.hi ) ), L::max( L::mul( a.hi, bl ), L::mul( a.hi, b.hi ) ) ) );
+  }
+};
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- BATCHED FACE PRODUCTS --------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnFaceBatch    // products of the vector field on cells Gamma_i + P*face_ij of one face row with the face normal n
+                      // the mean value form n.f(xc) + n^T Df(X) (Gamma_i - Gc) + n^T Df(X) P (face_ij - yc) is intersected with n.f(X)
+{
+public:
+  int c;                    // coordinate fixed on the face
+  int o;                    // coordinate along the face, varies between cells of the row
+
+  // row constants, all computed rigorously by CAPD in setRow
+  BoundPair theta, c1, c2, epsOverTheta;
+  BoundPair normal[3];
+  BoundPair P[3][3];
+  BoundPair base[3];        // Gamma_i + P[.][c]*face_i[c]
+  BoundPair baseCenter[3];  // Gc + P[.][c]*mid(face_i[c])
+  BoundPair dFaceFixed;     // face_i[c] - mid(face_i[c])
+  BoundPair nJdGamma;       // (n^T Df)_1 (Gamma_i - Gc)_1 + (n^T Df)_2 (Gamma_i - Gc)_2, the parts of n^T Df not depending on u are constant
+  BoundPair dGamma0;        // (Gamma_i - Gc)_0
+  BoundPair nJ1P[3];        // (n^T Df)_1 P[1][k] + (n^T Df)_2 P[2][k]
+
+  template<typename VectorType, typename MatrixType>
+  void setRow( const IFhnVectorField& kernel, const MatrixType& _P, const VectorType& Gamma_i, const VectorType& face_i, const VectorType& _normal, int _c )
+    // VectorType, MatrixType are those of the isolating segment (see FhnSpace)
+  {
+    c = _c;
+    o = 1 - _c;
+
+    theta = toBoundPair( kernel.theta );
+    c1 = toBoundPair( kernel.c1 );
+    c2 = toBoundPair( kernel.c2 );
+    epsOverTheta = toBoundPair( kernel.epsOverTheta );
+
+    interval nJ1( _normal[0] + _normal[1]*kernel.c2*kernel.theta );     // J[0] = (0,1,0), J[1] = (c2*cubic'(u), c2*theta, c2), J[2] = (eps/theta, 0, -eps/theta)
+    interval nJ2( _normal[1]*kernel.c2 - _normal[2]*kernel.epsOverTheta );
+
+    for(int r=0; r < 3; r++)
+    {
+      normal[r] = toBoundPair( _normal[r] );
+      for(int k=0; k < 3; k++)
+        P[r][k] = toBoundPair( _P[r][k] );
+
+      base[r] = toBoundPair( Gamma_i[r] + _P[r][c]*face_i[c] );
+      baseCenter[r] = toBoundPair( Gamma_i[r].mid() + _P[r][c]*face_i[c].mid() );
+      nJ1P[r] = toBoundPair( nJ1*_P[1][r] + nJ2*_P[2][r] );
+    }
+
+    dFaceFixed = toBoundPair( face_i[c] - face_i[c].mid() );
+    dGamma0 = toBoundPair( Gamma_i[0] - Gamma_i[0].mid() );
+    nJdGamma = toBoundPair( nJ1*( Gamma_i[1] - Gamma_i[1].mid() ) + nJ2*( Gamma_i[2] - Gamma_i[2].mid() ) );
+  }
+
+  template<typename L>
+  void field( const LaneInterval<L> x[3], LaneInterval<L> f[3] ) const   // the same formula as FhnVectorField
+  {
+    LaneInterval<L> one( L::set1( -1. ), L::set1( 1. ) );
+
+    f[0] = x[1];
+    f[1] = LaneInterval<L>( c2 )*( LaneInterval<L>( theta )*x[1] + x[0]*( x[0] - one )*( x[0] - LaneInterval<L>( c1 ) ) + x[2] );
+    f[2] = LaneInterval<L>( epsOverTheta )*( x[0] - x[2] );
+  }
+
+  template<typename L>
+  void evaluateCells( int begin, int end, const double* faceNlo, const double* faceHi, double* productNlo, double* productHi ) const  // cells begin, ..., end-1, end-begin divisible by L::width
+  {
+    typedef LaneInterval<L> LI;
+
+    LI one( L::set1( -1. ), L::set1( 1. ) );
+    LI Pc( P[0][c] ), Po( P[0][o] );
+
+    for(int j = begin; j < end; j += L::width)
+    {
+      LI face( L::load( faceNlo + j ), L::load( faceHi + j ) );
+      typename L::V mid( L::mul( L::add( L::neg( face.nlo ), face.hi ), L::set1( 0.5 ) ) );   // rounded upward, but still inside the cell
+      LI faceMid( L::neg( mid ), mid );
+
+      LI X[3], xc[3];
+      for(int r=0; r < 3; r++)
+      {
+        X[r] = LI( base[r] ) + LI( P[r][o] )*face;
+        xc[r] = LI( baseCenter[r] ) + LI( P[r][o] )*faceMid;
+      }
+
+      LI fX[3], fc[3];
+      field<L>( X, fX );
+      field<L>( xc, fc );
+
+      LI n[3] = { LI( normal[0] ), LI( normal[1] ), LI( normal[2] ) };
+
+      LI natural( n[0]*fX[0] + n[1]*fX[1] + n[2]*fX[2] );
+
+      LI cubicDerivative( ( X[0] - one )*( X[0] - LI( c1 ) ) + X[0]*( X[0] - LI( c1 ) ) + X[0]*( X[0] - one ) );
+      LI nJ0( n[1]*LI( c2 )*cubicDerivative + n[2]*LI( epsOverTheta ) );   // (n^T Df(X))_0
+
+      LI meanValue( n[0]*fc[0] + n[1]*fc[1] + n[2]*fc[2] + nJ0*LI( dGamma0 ) + LI( nJdGamma )
+                    + ( nJ0*Pc + LI( nJ1P[c] ) )*LI( dFaceFixed ) + ( nJ0*Po + LI( nJ1P[o] ) )*( face - faceMid ) );
+
+      L::store( productNlo + j, L::min( natural.nlo, meanValue.nlo ) );     // intersection of the two enclosures
+      L::store( productHi + j, L::min( natural.hi, meanValue.hi ) );
+    }
+  }
+
+  interval evaluateRow( int n, const double* faceNlo, const double* faceHi, double* productNlo, double* productHi ) const
+    // products on cells with coordinate o equal to [-faceNlo[j], faceHi[j]], j = 0, ..., n-1, are stored in productNlo, productHi, returns their hull
+  {
+    double hullNlo, hullHi;
+    {
+      RoundUpward upward;
+
+      int vectorEnd( 0 );
+#ifdef __AVX2__
+      vectorEnd = n - n % AvxLanes::width;
+      evaluateCells<AvxLanes>( 0, vectorEnd, faceNlo, faceHi, productNlo, productHi );
+#endif
+      evaluateCells<ScalarLanes>( vectorEnd, n, faceNlo, faceHi, productNlo, productHi );
+
+      hullNlo = productNlo[0];
+      hullHi = productHi[0];
+      for(int j=1; j < n; j++)
+      {
+        hullNlo = ( productNlo[j] > hullNlo ? productNlo[j] : hullNlo );
+        hullHi = ( productHi[j] > hullHi ? productHi[j] : hullHi );
+      }
+    }
+
+    for(int j=0; j < n; j++)
+      if( -productNlo[j] > productHi[j] )
+        throw "EMPTY INTERSECTION OF VECTOR FIELD ENCLOSURES! \n";  // both are enclosures of the same set, this can only be a bug
+
+    return interval( -hullNlo, hullHi );
+  }
+};
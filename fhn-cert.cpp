@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include "fhn.hpp"
+
+
+// ---------------------------------------------------------------------------------
+// --------------------------- CERTIFICATE CHECKER ---------------------------------
+// ---------------------------------------------------------------------------------
+
+// Reads a certificate written by FhnVerifyExistenceOfPeriodicOrbit (see certificate.hpp) and checks for every run that claims
+// a verified periodic orbit the conditions its records contain: the covering conditions on the images of both Poincare maps,
+// the signs of the products on all face boxes of all six segments (negative on entrance faces, positive on exit faces)
+// and that the face boxes of every face of every (sub)segment tile the whole face exactly. The records do not contain the geometry,
+// so it is not checked here that the faces of the segments are the ones given by the images, nor the coverings between subsegments
+// (fhn-check verifies these from the geometry file) or the alignment of the corner segments. The certificate is read once in blocks,
+// a run is checked and forgotten as soon as its result record is read. One CSV line is written per run,
+// the exit status is 1 if some run claims a verification which its records do not support.
+
+typedef std::tuple<int, int, int> FhnFaceBox;   // (cells, i, j) of the face box [i-1,i]/cells x [j-1,j]/cells
+
+bool exactTiling( std::vector<FhnFaceBox>& boxes ) // whether the boxes are disjoint and cover the face: all cells are the cells of the coarsest boxes times powers of 2,
+                                                   // so two boxes either nest or are disjoint, no box lies in another one (or is repeated) and the areas of the boxes
+                                                   // in every coarsest cell add up to its area exactly
+{
+  const int maxLevel( 30 );     // areas are counted in units of boxes 2^maxLevel times finer than the coarsest ones
+  if( boxes.empty() )
+    return 0;
+
+  std::sort( boxes.begin(), boxes.end() );
+  if( std::adjacent_find( boxes.begin(), boxes.end() ) != boxes.end() )
+    return 0;
+
+  long coarse( std::get<0>( boxes[0] ) );
+  std::map< std::pair<int, int>, uint64_t > area;    // coarsest cell -> area of the boxes in it
+
+  for( size_t k = 0; k < boxes.size(); k++ )
+  {
+    long cells( std::get<0>( boxes[k] ) );
+    int i( std::get<1>( boxes[k] ) ), j( std::get<2>( boxes[k] ) );
+    int level( 0 );
+    while( level < maxLevel && ( coarse << level ) < cells )
+      level++;
+    if( ( coarse << level ) != cells || i < 1 || i > cells || j < 1 || j > cells )
+      return 0;
+
+    for( int up = 1; up <= level; up++ )    // boxes containing this one
+      if( std::binary_search( boxes.begin(), boxes.end(), FhnFaceBox( int( cells >> up ), ( ( i-1 ) >> up ) + 1, ( ( j-1 ) >> up ) + 1 ) ) )
+        return 0;
+
+    area[ std::make_pair( ( ( i-1 ) >> level ) + 1, ( ( j-1 ) >> level ) + 1 ) ] += uint64_t( 1 ) << 2*( maxLevel - level );
+  }
+
+  if( long( area.size() ) != coarse*coarse )
+    return 0;
+  for( std::map< std::pair<int, int>, uint64_t >::iterator it = area.begin(); it != area.end(); ++it )
+    if( it->second != uint64_t( 1 ) << 2*maxLevel )
+      return 0;
+  return 1;
+}
+
+struct FhnCertificateRun
+{
+  double theta[2];
+  double eps[2];
+  long records;
+  long wrongSigns;                                              // face boxes whose products do not have the required sign
+  std::map< std::tuple<int, int, int>, std::vector<FhnFaceBox> > faceBoxes;   // (stage, subsegment, face) -> its face boxes
+  std::map< std::tuple<int, int, int>, FhnCertificateRecord > images;   // (stage, item, coordinate) -> enclosure
+
+  FhnCertificateRun() : records( 0 ), wrongSigns( 0 )
+  {
+    theta[0] = theta[1] = eps[0] = eps[1] = 0.;
+  }
+
+  void add( const FhnCertificateRecord& record )
+  {
+    records++;
+    if( record.stage == FhnCertificateRecord::PARAMETERS )
+    {
+      double* bounds( record.face == 0 ? theta : eps );
+      bounds[0] = record.lo;
+      bounds[1] = record.hi;
+    }
+    else if( record.stage == FhnCertificateRecord::LEFT_POINCARE_MAP || record.stage == FhnCertificateRecord::RIGHT_POINCARE_MAP )
+      images[ std::make_tuple( int( record.stage ), int( record.face ), int( record.i ) ) ] = record;
+    else if( record.cells > 0 )
+    {
+      bool entrance( record.face < FhnIsolatingSegment::UL );
+      if( !( entrance ? record.hi < 0. : record.lo > 0. ) )
+        wrongSigns++;
+      faceBoxes[ std::make_tuple( int( record.stage ), int( record.subsegment ), int( record.face ) ) ].push_back( FhnFaceBox( record.cells, record.i, record.j ) );
+    }
+  }
+
+  bool image( int stage, int item, int coordinate, FhnCertificateRecord& record )
+  {
+    std::map< std::tuple<int, int, int>, FhnCertificateRecord >::iterator found( images.find( std::make_tuple( stage, item, coordinate ) ) );
+    if( found == images.end() )
+      return 0;
+    record = found->second;
+    return 1;
+  }
+
+  std::string check() // the first condition which does not hold, empty if the records support the verification
+  {
+    for( int stage = FhnCertificateRecord::LEFT_POINCARE_MAP; stage <= FhnCertificateRecord::RIGHT_POINCARE_MAP; stage++ )
+    {
+      FhnCertificateRecord leftU, rightU, all;
+      if( !( image( stage, 0, 1, leftU ) && image( stage, 1, 1, rightU ) && image( stage, 2, 0, all ) ) )
+        return "missing Poincare map images";
+      if( !( interval( leftU.lo, leftU.hi ) + EPS < 0. && interval( rightU.lo, rightU.hi ) - EPS > 0. && all.lo < 0. && all.hi > 0. ) )   // as in the proof
+        return "Poincare map covering";
+    }
+
+    if( wrongSigns > 0 )
+      return "face boxes without the required sign";
+
+    for( int stage = FhnCertificateRecord::UL_SEGMENT; stage <= FhnCertificateRecord::DOWN_SEGMENTS; stage++ )
+    {
+      bool regular( stage >= FhnCertificateRecord::UP_SEGMENTS );
+      int subsegments( 0 );
+      while( faceBoxes.count( std::make_tuple( stage, regular ? subsegments : -1, 0 ) ) )
+        subsegments++;
+      if( subsegments == 0 || ( !regular && subsegments > 1 ) )
+        return "missing segment";
+      for( int k = 0; k < ( regular ? subsegments : 1 ); k++ )
+        for( int face = 0; face < 4; face++ )
+        {
+          std::tuple<int, int, int> key( stage, regular ? k : -1, face );
+          if( !faceBoxes.count( key ) || !exactTiling( faceBoxes[key] ) )
+            return "face boxes do not tile a face";
+        }
+    }
+
+    return "";
+  }
+};
+
+const char* usage =
+  "usage: fhn-cert CERTIFICATE [--output FILE]\n"
+  "  --output FILE       results in CSV format (default standard output)\n";
+
+int main( int argc, char* argv[] ){
+
+  const char* certificateFile( 0 );
+  const char* outputFile( 0 );
+
+  for( int k = 1; k < argc; k++ )
+  {
+    if( !std::strcmp( argv[k], "--output" ) && k + 1 < argc )
+      outputFile = argv[++k];
+    else if( !certificateFile && argv[k][0] != '-' )
+      certificateFile = argv[k];
+    else
+    {
+      std::cerr << usage;
+      return 1;
+    }
+  }
+  if( !certificateFile )
+  {
+    std::cerr << usage;
+    return 1;
+  }
+
+  std::FILE* output( outputFile ? std::fopen( outputFile, "w" ) : stdout );
+  if( !output )
+  {
+    std::cerr << "Cannot write to " << outputFile << "\n";
+    return 1;
+  }
+
+  std::map< uint32_t, FhnCertificateRun > runs;   // runs whose result record has not been read yet
+  long records( 0 ), claimed( 0 ), unsupported( 0 );
+
+  try
+  {
+    FhnCertificateReader reader( certificateFile );
+    FhnCertificateRecord record;
+
+    std::fprintf( output, "run,theta_lo,theta_hi,eps_lo,eps_hi,claimed,checked,records,failed_condition\n" );
+
+    while( reader.next( record ) )
+    {
+      records++;
+      if( record.stage >= FhnCertificateRecord::STAGE_COUNT )
+        throw "CORRUPTED CERTIFICATE! \n";
+
+      FhnCertificateRun& run( runs[record.run] );
+      if( record.stage != FhnCertificateRecord::RESULT )
+      {
+        run.add( record );
+        continue;
+      }
+
+      bool verified( record.face != 0 );
+      std::string failed( verified ? run.check() : "" );
+      claimed += verified;
+      unsupported += ( verified && !failed.empty() );
+
+      std::fprintf( output, "%u,%.17g,%.17g,%.17g,%.17g,%d,%d,%ld,%s\n", record.run, run.theta[0], run.theta[1], run.eps[0], run.eps[1],
+                    int( verified ), int( verified && failed.empty() ), run.records, failed.c_str() );
+      runs.erase( record.run );
+    }
+  }
+  catch(const char* Message)
+  {
+    std::cerr << Message;
+    return 1;
+  }
+
+  if( outputFile )
+    std::fclose( output );
+
+  std::cerr << records << " records, " << claimed << " verified runs, " << unsupported << " not supported by their records, "
+            << runs.size() << " unfinished runs \n";
+  return ( unsupported > 0 ? 1 : 0 );
+}
@@ -0,0 +1,426 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include "fhn.hpp"
+
+
+// ---------------------------------------------------------------------------------
+// --------------------------- SEGMENT RE-VERIFICATION -----------------------------
+// ---------------------------------------------------------------------------------
+
+// Verifies the isolation of all segments of stored proofs again from their geometry alone, without any integration:
+// reads the geometry file written with a certificate (see certificate.hpp), i.e. end points, coordinate changes, faces
+// and discretizations of all corner segments and subsegments of long segments, and evaluates the products of the vector
+// field with the face normals on all face boxes, as well as the coverings between consecutive subsegments.
+// The products are evaluated by CAPD (moving C0Rect2Sets by the IMap), not by the hand-written vector field the proof uses, so that
+// an error of the latter is not repeated here (--kernel uses it as well, which is faster but not independent).
+// The work is split into rows of the face grids (see FhnIsolatingSegmentT::verifyFaceRow), which are handed out to all cores.
+// A run is verified if the proof claimed so, its geometry is complete (the four corner segments, all subsegments of both long segments
+// and the coverings between consecutive ones) and fits together (see inconsistentGeometry), all its segments have the same parameters
+// and all of it is verified again. One CSV line is written per run, the exit status is 1 if some run claimed by the proof is not verified.
+
+struct FhnSegmentGeometry
+{
+  unsigned int run;
+  int stage;
+  int subsegment;
+  interval disc;
+  int refineDepth;
+  interval theta;
+  interval eps;
+  IVector GammaLeft;
+  IVector GammaRight;
+  IMatrix P;
+  IVector leftFace;
+  IVector rightFace;
+};
+
+struct FhnCoveringGeometry
+{
+  unsigned int run;
+  int stage;
+  int subsegment;
+  IVector Face_i0;
+  IMatrix P_i0;
+  IMatrix P_i1;
+  IVector Face_i0_adj;
+};
+
+struct FhnRunResult               // the result line of a run
+{
+  bool verified;
+  int subsegments;                // of each long segment
+};
+
+struct FhnRunCheck                // results of all segments and coverings of one run
+{
+  interval theta;
+  interval eps;
+  int segments;
+  int coverings;
+  long rows;
+  long failedRows;
+  int failedCoverings;
+  std::string failedLocation;     // the first segment (stage, subsegment) whose isolation is not verified
+  bool mixedParameters;           // whether some segment lines have other theta or eps than the first one
+  std::map< std::pair<int, int>, int > segmentCounts;    // (stage, subsegment) -> number of its segment lines
+  std::map< std::pair<int, int>, int > coveringCounts;   // the same for covering lines
+  std::map< std::pair<int, int>, int > segmentLines;     // (stage, subsegment) -> index of its (last) segment line
+  std::map< std::pair<int, int>, int > coveringLines;    // the same for covering lines
+
+  FhnRunCheck() : segments( 0 ), coverings( 0 ), rows( 0 ), failedRows( 0 ), failedCoverings( 0 ), mixedParameters( 0 ) {}
+};
+
+FhnIsolatingSegment* newSegment( const FhnSegmentGeometry& S, bool useKernel ) // with its own copy of the vector field, throws if the slow vector field may vanish on it
+{
+  IMap vectorField( Fhn_vf );
+  vectorField.setParameter("theta", S.theta);
+  vectorField.setParameter("eps", S.eps);
+
+  FhnIsolatingSegment* segment( new FhnIsolatingSegment( vectorField, S.GammaLeft, S.GammaRight, S.P, S.leftFace, S.rightFace, S.disc ) );
+  segment->refineDepth = S.refineDepth;
+  segment->useKernel = useKernel;
+  return segment;
+}
+
+bool readGeometry( const char* path, std::vector<FhnSegmentGeometry>& segments, std::vector<FhnCoveringGeometry>& coverings, 
+                   std::map<unsigned int, FhnRunResult>& results )
+{
+  std::ifstream input( path );
+  if( !input )
+    return 0;
+
+  std::string text;
+  while( std::getline( input, text ) )
+  {
+    std::istringstream line( text );
+    std::string kind;
+    line >> kind;
+
+    if( kind == "segment" )
+    {
+      FhnSegmentGeometry S;
+      double disc;
+      line >> S.run >> S.stage >> S.subsegment >> disc >> S.refineDepth;
+      S.disc = disc;
+      IVector parameters( FhnReadVector( line, 2 ) );
+      S.theta = parameters[0];
+      S.eps = parameters[1];
+      S.GammaLeft = FhnReadVector( line, 3 );
+      S.GammaRight = FhnReadVector( line, 3 );
+      S.P = FhnReadMatrix( line, 3, 3 );
+      S.leftFace = FhnReadVector( line, 3 );
+      S.rightFace = FhnReadVector( line, 3 );
+      if( !line )
+        return 0;
+      segments.push_back( S );
+    }
+    else if( kind == "covering" )
+    {
+      FhnCoveringGeometry C;
+      line >> C.run >> C.stage >> C.subsegment;
+      C.Face_i0 = FhnReadVector( line, 3 );
+      C.P_i0 = FhnReadMatrix( line, 3, 3 );
+      C.P_i1 = FhnReadMatrix( line, 3, 3 );
+      C.Face_i0_adj = FhnReadVector( line, 3 );
+      if( !line )
+        return 0;
+      coverings.push_back( C );
+    }
+    else if( kind == "result" )
+    {
+      unsigned int run;
+      int verified;
+      FhnRunResult R;
+      line >> run >> verified >> R.subsegments;
+      if( !line )
+        return 0;
+      R.verified = ( verified != 0 );
+      results[run] = R;
+    }
+    else if( !kind.empty() )
+      return 0;
+  }
+  return 1;
+}
+
+std::string segmentName( int stage, int subsegment )
+{
+  const char* names[FhnCertificateRecord::STAGE_COUNT] = { "", "", "", "", "UL segment", "DL segment", "UR segment", "DR segment", "up segments", "down segments" };
+  std::string name( stage >= 0 && stage < FhnCertificateRecord::STAGE_COUNT ? names[stage] : "unknown stage" );
+  if( subsegment >= 0 )
+    name += " subsegment " + std::to_string( subsegment );
+  return name;
+}
+
+std::string missingGeometry( const FhnRunCheck& run, int subsegments ) // the first segment or covering the run lacks (or has more than once), empty if it is complete
+{
+  for( int stage = FhnCertificateRecord::UL_SEGMENT; stage <= FhnCertificateRecord::DR_SEGMENT; stage++ )
+    if( !run.segmentCounts.count( std::make_pair( stage, -1 ) ) || run.segmentCounts.at( std::make_pair( stage, -1 ) ) != 1 )
+      return segmentName( stage, -1 );
+
+  for( int stage = FhnCertificateRecord::UP_SEGMENTS; stage <= FhnCertificateRecord::DOWN_SEGMENTS; stage++ )
+    for( int i = 0; i < subsegments; i++ )
+    {
+      std::pair<int, int> key( stage, i );
+      if( !run.segmentCounts.count( key ) || run.segmentCounts.at( key ) != 1 )
+        return segmentName( stage, i );
+      if( i < subsegments - 1 && ( !run.coveringCounts.count( key ) || run.coveringCounts.at( key ) != 1 ) )
+        return segmentName( stage, i ) + " covering";
+    }
+
+  if( run.segments != 4 + 2*subsegments || run.coverings != 2*( subsegments - 1 ) )
+    return "segments or coverings of other stages";
+  return "";
+}
+
+bool sameVector( const IVector& a, const IVector& b ) // bound by bound, the geometry file stores all bounds exactly
+{
+  if( a.dimension() != b.dimension() )
+    return 0;
+  for(int k=0; k < a.dimension(); k++)
+    if( a[k].leftBound() != b[k].leftBound() || a[k].rightBound() != b[k].rightBound() )
+      return 0;
+  return 1;
+}
+
+bool sameMatrix( const IMatrix& A, const IMatrix& B )
+{
+  if( A.numberOfRows() != B.numberOfRows() || A.numberOfColumns() != B.numberOfColumns() )
+    return 0;
+  for(int i=0; i < A.numberOfRows(); i++)
+    for(int j=0; j < A.numberOfColumns(); j++)
+      if( A[i][j].leftBound() != B[i][j].leftBound() || A[i][j].rightBound() != B[i][j].rightBound() )
+        return 0;
+  return 1;
+}
+
+std::string inconsistentGeometry( const FhnRunCheck& run, int subsegments, const std::vector<FhnSegmentGeometry>& segments, 
+                                  const std::vector<FhnCoveringGeometry>& coverings )
+  // the first place where the segments and coverings of a complete run (see missingGeometry) do not fit together, empty if they do:
+  // each long segment starts where its left corner segment ends and each of its subsegments where the previous one ends, covering i
+  // (as written by longIsolatingSegment::entranceAndExitVerification) maps the right face of the segment before subsegment i in its coordinates
+  // onto the left face of subsegment i in the coordinates of subsegment i, and the last subsegment ends on the left face of the right corner segment
+{
+  const int starts[2] = { FhnCertificateRecord::UL_SEGMENT, FhnCertificateRecord::DL_SEGMENT };
+  const int ends[2] = { FhnCertificateRecord::UR_SEGMENT, FhnCertificateRecord::DR_SEGMENT };
+
+  for( int k = 0; k < 2; k++ )
+  {
+    int stage( FhnCertificateRecord::UP_SEGMENTS + k );
+    const FhnSegmentGeometry* previous( &segments[ run.segmentLines.at( std::make_pair( starts[k], -1 ) ) ] );
+
+    for( int i = 0; i < subsegments; i++ )
+    {
+      const FhnSegmentGeometry& S( segments[ run.segmentLines.at( std::make_pair( stage, i ) ) ] );
+      if( !sameVector( S.GammaLeft, previous->GammaRight ) )
+        return segmentName( stage, i ) + " does not start where the previous segment ends";
+
+      if( i < subsegments - 1 )
+      {
+        const FhnCoveringGeometry& C( coverings[ run.coveringLines.at( std::make_pair( stage, i ) ) ] );
+        if( !sameVector( C.Face_i0, previous->rightFace ) || !sameMatrix( C.P_i0, previous->P ) || !sameMatrix( C.P_i1, S.P ) || !sameVector( C.Face_i0_adj, S.leftFace ) )
+          return segmentName( stage, i ) + " covering does not match the faces of its segments";
+      }
+      previous = &S;
+    }
+
+    const FhnSegmentGeometry& corner( segments[ run.segmentLines.at( std::make_pair( ends[k], -1 ) ) ] );
+    if( !sameVector( previous->GammaRight, corner.GammaLeft ) || !sameVector( previous->rightFace, corner.leftFace ) || !sameMatrix( previous->P, corner.P ) )
+      return segmentName( stage, subsegments - 1 ) + " does not end on the " + segmentName( ends[k], -1 );
+  }
+  return "";
+}
+
+const char* usage =
+  "usage: fhn-check GEOMETRY [options]\n"
+  "  --threads N         threads verifying face rows (default 0 - all cores)\n"
+  "  --output FILE       results in CSV format (default standard output)\n"
+  "  --kernel            evaluate the products by the hand-written vector field of the proof instead of the IMap (faster, not independent)\n";
+
+int main( int argc, char* argv[] ){
+
+  const char* geometryFile( 0 );
+  const char* outputFile( 0 );
+  int threads( 0 );
+  bool useKernel( 0 );
+
+  for( int k = 1; k < argc; k++ )
+  {
+    if( !std::strcmp( argv[k], "--threads" ) && k + 1 < argc )
+      threads = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--output" ) && k + 1 < argc )
+      outputFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--kernel" ) )
+      useKernel = 1;
+    else if( !geometryFile && argv[k][0] != '-' )
+      geometryFile = argv[k];
+    else
+    {
+      std::cerr << usage;
+      return 1;
+    }
+  }
+  if( !geometryFile )
+  {
+    std::cerr << usage;
+    return 1;
+  }
+
+  std::vector<FhnSegmentGeometry> segments;
+  std::vector<FhnCoveringGeometry> coverings;
+  std::map<unsigned int, FhnRunResult> results;
+  if( !readGeometry( geometryFile, segments, coverings, results ) )
+  {
+    std::cerr << "Cannot read segment geometry from " << geometryFile << "\n";
+    return 1;
+  }
+
+  std::FILE* output( outputFile ? std::fopen( outputFile, "w" ) : stdout );
+  if( !output )
+  {
+    std::cerr << "Cannot write to " << outputFile << "\n";
+    return 1;
+  }
+
+  std::chrono::steady_clock::time_point start( std::chrono::steady_clock::now() );
+  int workers( threadCount( threads ) );
+
+  // segments are set up serially first (this also checks that the slow vector field does not vanish on them) to list their face rows,
+  // workers then verify rows on segments of their own, each with its own copy of the vector field
+
+  std::vector<std::string> setupFailures( segments.size() );
+
+  struct Row { int segment; int face; int i; };
+  std::vector<Row> rows;
+
+  for( size_t s = 0; s < segments.size(); s++ )
+  {
+    std::unique_ptr<FhnIsolatingSegment> segment;
+    try
+    {
+      segment.reset( newSegment( segments[s], useKernel ) );
+    }
+    catch(const char* Message)
+    {
+      setupFailures[s] = Message;
+      continue;
+    }
+
+    for( int face = FhnIsolatingSegment::SL; face <= FhnIsolatingSegment::UR; face++ )
+      for( int i = 1; i <= segment->faceRowCount(); i++ )
+      {
+        Row row = { int(s), face, i };
+        rows.push_back( row );
+      }
+  }
+
+  std::vector<char> rowVerified( rows.size(), 0 );
+  std::vector<std::string> rowLocations( rows.size() );
+  std::vector< std::unique_ptr<FhnIsolatingSegment> > current( workers );   // the segment each worker is verifying rows of
+  std::vector<int> currentSegment( workers, -1 );
+
+  parallelFor( rows.size(), workers, [&]( int w, int r )     // rows of a segment are consecutive, so workers rarely set up new segments
+  {
+    const Row& row( rows[r] );
+    if( currentSegment[w] != row.segment )
+    {
+      current[w].reset( newSegment( segments[row.segment], useKernel ) );
+      currentSegment[w] = row.segment;
+    }
+
+    interval hull;
+    rowVerified[r] = current[w]->verifyFaceRow( row.face, row.i, hull );
+    if( !rowVerified[r] )
+      rowLocations[r] = current[w]->violation.location();
+  } );
+
+  std::vector<char> coveringVerified( coverings.size(), 0 );
+
+  parallelFor( coverings.size(), workers, [&]( int, int c )
+  {
+    FhnCoveringGeometry C( coverings[c] );   // isCovering takes the sets by non-const references
+    coveringVerified[c] = isCovering( C.Face_i0, inverseMatrix(C.P_i1)*C.P_i0, C.Face_i0_adj );
+  } );
+
+  // results by runs
+
+  std::map<unsigned int, FhnRunCheck> runs;
+
+  for( size_t s = 0; s < segments.size(); s++ )
+  {
+    FhnRunCheck& run( runs[segments[s].run] );
+    if( run.segments == 0 )
+    {
+      run.theta = segments[s].theta;
+      run.eps = segments[s].eps;
+    }
+    else if( !sameVector( IVector({ run.theta, run.eps }), IVector({ segments[s].theta, segments[s].eps }) ) )
+      run.mixedParameters = 1;
+    run.segments++;
+    run.segmentCounts[ std::make_pair( segments[s].stage, segments[s].subsegment ) ]++;
+    run.segmentLines[ std::make_pair( segments[s].stage, segments[s].subsegment ) ] = s;
+    if( !setupFailures[s].empty() && run.failedLocation.empty() )
+      run.failedLocation = segmentName( segments[s].stage, segments[s].subsegment ) + ": " + setupFailures[s];
+  }
+
+  for( size_t r = 0; r < rows.size(); r++ )
+  {
+    const FhnSegmentGeometry& S( segments[ rows[r].segment ] );
+    FhnRunCheck& run( runs[S.run] );
+    run.rows++;
+    if( !rowVerified[r] )
+    {
+      run.failedRows++;
+      if( run.failedLocation.empty() )
+        run.failedLocation = segmentName( S.stage, S.subsegment ) + ": " + rowLocations[r];
+    }
+  }
+
+  for( size_t c = 0; c < coverings.size(); c++ )
+  {
+    FhnRunCheck& run( runs[coverings[c].run] );
+    run.coverings++;
+    run.coveringCounts[ std::make_pair( coverings[c].stage, coverings[c].subsegment ) ]++;
+    run.coveringLines[ std::make_pair( coverings[c].stage, coverings[c].subsegment ) ] = c;
+    if( !coveringVerified[c] )
+    {
+      run.failedCoverings++;
+      if( run.failedLocation.empty() )
+        run.failedLocation = segmentName( coverings[c].stage, coverings[c].subsegment ) + ": no covering of the previous subsegment";
+    }
+  }
+
+  for( std::map<unsigned int, FhnRunResult>::iterator it = results.begin(); it != results.end(); ++it )
+    runs[it->first];             // runs which failed before their first segment have no other lines
+
+  std::fprintf( output, "run,theta_lo,theta_hi,eps_lo,eps_hi,segments,coverings,face_rows,failed_rows,failed_coverings,claimed,verified,failed_location\n" );
+  int failedRuns( 0 );
+
+  for( std::map<unsigned int, FhnRunCheck>::iterator it = runs.begin(); it != runs.end(); ++it )
+  {
+    const FhnRunCheck& run( it->second );
+    bool finished( results.count( it->first ) > 0 );
+    bool claimed( finished && results[it->first].verified );
+    std::string missing( finished ? missingGeometry( run, results[it->first].subsegments ) : "" );
+    std::string inconsistent( finished && missing.empty() ? inconsistentGeometry( run, results[it->first].subsegments, segments, coverings ) : "" );
+    std::string failedLocation( !finished ? "no result of the run" : !run.failedLocation.empty() ? run.failedLocation 
+                                : !missing.empty() ? "missing " + missing : !inconsistent.empty() ? inconsistent 
+                                : run.mixedParameters ? "segments of different parameters" : "" );
+    bool verified( claimed && failedLocation.empty() );
+    failedRuns += ( claimed && !verified );
+    std::fprintf( output, "%u,%.17g,%.17g,%.17g,%.17g,%d,%d,%ld,%ld,%d,%d,%d,%s\n", it->first, run.theta.leftBound(), run.theta.rightBound(),
+                  run.eps.leftBound(), run.eps.rightBound(), run.segments, run.coverings, run.rows, run.failedRows, run.failedCoverings,
+                  int( claimed ), int( verified ), failedLocation.c_str() );
+  }
+
+  if( outputFile )
+    std::fclose( output );
+
+  std::cerr << segments.size() << " segments, " << rows.size() << " face rows, " << coverings.size() << " coverings of " << runs.size() << " runs verified in "
+            << std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() << " seconds, " << failedRuns << " runs claimed by the proof not verified \n";
+  return ( failedRuns > 0 ? 1 : 0 );
+}
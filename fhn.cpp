@@ -1,31 +1,5 @@
-#include <iostream>
-#include "capd/capdlib.h"
-#include "capd/dynsys/DiscreteDynSys.h"
-
-using std::cout;
-using namespace capd;
-using namespace matrixAlgorithms;
-using namespace dynsys;
-
-// in all diagonalizations, unless otherwise stated, first variable is stable second unstable third (if present) neutral
-
-const interval EPS = interval(1./1e15);  // small number greater than zero for coverings
-const double accuracy = 1e-12;           // accuracy for nonrigorous numerics (i.e. approximation of the slow manifold)
-const int order = 18;                    // order for all the Taylor integrators (high is fast)
-
-IMap Fhn_vf("par:theta,eps;var:u,w,v;fun:w,(2/10)*(theta*w+u*(u-1)*(u-(1/10))+v),(eps/theta)*(u-v);"); 
-// FitzHugh-Nagumo vector field is u'=w, w'=0.2*(theta*w +u*(u-1)*(u-0.1)+v, v'= eps/theta * (u-v)
-IMap Fhn_vf_rev("par:theta,eps;var:u,w,v;fun:-w,(-2/10)*(theta*w+u*(u-1)*(u-(1/10))+v),(-eps/theta)*(u-v);"); 
-// reversed field for backward integration
-IMap Fhn_vf_withParams("var:u,w,v,theta,eps;fun:w,(2/10)*(theta*w+u*(u-1)*(u-(1/10))+v),(eps/theta)*(u-v),0,0;"); 
-// the same vector field with parameters as variables of velocity 0
-IMap Fhn_vf_withParams_rev("var:u,w,v,theta,eps;fun:-w,(-2/10)*(theta*w+u*(u-1)*(u-(1/10))+v),(-eps/theta)*(u-v),0,0;"); 
-// again, the reversed vector field with parameters of velocity 0
-
-#include "numerics.hpp"   // Warning! When changing the vector field, one needs to make manual changes in this header file (class FhnBifurcation)!
-#include "poincare.hpp"
-#include "segments.hpp"
-#include "proof.hpp"
+#include <cstring>
+#include "fhn.hpp"
 
 
 // ---------------------------------------------------------------------------------
@@ -35,15 +9,39 @@ IMap Fhn_vf_withParams_rev("var:u,w,v,theta,eps;fun:-w,(-2/10)*(theta*w+u*(u-1)*
 
 
 
-int main(){
+int main( int argc, char* argv[] ){
 
   cout.precision(9);
 
   interval theta = interval(61.)/100.;
   interval eps = interval(0.,1.)/1e6; //interval(0.,1.)/2e6;
   bool verbose = 0; 
+  int threads = 0;  // 0 - use all available cores
+  const char* checkpointFile( 0 );   // only with fhn --checkpoint FILE finished stages of an interrupted run are not verified again
+  const char* cacheFile( 0 );        // only with fhn --cache FILE corner points and coordinate changes of previous runs are reused
+
+  for( int k = 1; k < argc; k += 2 )
+  {
+    if( k + 1 < argc && !std::strcmp( argv[k], "--checkpoint" ) )
+      checkpointFile = argv[k+1];
+    else if( k + 1 < argc && !std::strcmp( argv[k], "--cache" ) )
+      cacheFile = argv[k+1];
+    else
+    {
+      std::cerr << "usage: fhn [--checkpoint FILE] [--cache FILE]\n";
+      return 1;
+    }
+  }
+
+  std::unique_ptr<FhnCheckpoint> checkpoint( checkpointFile ? new FhnCheckpoint( checkpointFile ) : 0 );
+  std::unique_ptr<FhnPreprocessingCache> preprocessingCache( cacheFile ? new FhnPreprocessingCache( cacheFile ) : 0 );
   
-  FhnVerifyExistenceOfPeriodicOrbit( theta, eps, verbose, 1 );
+  FhnProofSettings settings;
+  settings.threadCount = threads;
+  settings.preprocessingCache = preprocessingCache.get();
+  settings.checkpoint = checkpoint.get();
+
+  FhnVerifyExistenceOfPeriodicOrbit( theta, eps, verbose, 1, 20, 100, 80, 200, settings );
  // FhnVerifyExistenceOfPeriodicOrbit( theta, eps, verbose );
 
 //  theta = interval(63.)/100;
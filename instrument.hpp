@@ -0,0 +1,120 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing instrumentation of a verification: counters of the
+ * work done by its stages (Poincare map calls, face boxes, ...) and wall times of the stages,
+ * reported in JSON. The counters are taken from the counts the classes of the proof keep about
+ * their last calls (cellCount, evaluationCount, ...) once a stage finishes, nothing is counted
+ * in the inner loops, and with instrumentation disabled (a null FhnInstrumentation*) the timers
+ * do not even read the clock.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- INSTRUMENTATION --------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnInstrumentation      // counters and stage timers of one verification, can be shared by the threads of the verification
+{
+public:
+  enum Counter
+  {
+    SHOOTING_EVALUATIONS,     // w_function evaluations (pairs of integrations of the fast subsystem) correcting the corner points
+    POINCARE_MAP_CALLS,       // calls of CAPD Poincare maps, one per integrated cell (the Taylor steps they take are not exposed, so they are not counted)
+    FACE_BOXES,               // face boxes on which the product of the vector field with the face normal was evaluated (each takes two enclosures of
+                              // the vector field and one of its Jacobian by the kernel, vector field evaluations are not counted separately)
+    SUBSEGMENTS,              // subsegments of long isolating segments set up and verified
+    NEWTON_ITERATIONS,        // Newton iterations times points corrected as end points of subsegments (see longIsolatingSegment::slowManifoldPoints)
+    COUNTER_COUNT
+  };
+
+  struct Stage
+  {
+    std::string name;
+    double start;             // seconds since the instrumentation was created
+    double seconds;
+  };
+
+  std::atomic<long> counters[COUNTER_COUNT];
+  std::vector<Stage> stages;
+  std::mutex mutex;
+  std::chrono::steady_clock::time_point origin;
+
+  FhnInstrumentation() : origin( std::chrono::steady_clock::now() )
+  {
+    for( int c = 0; c < COUNTER_COUNT; c++ )
+      counters[c] = 0;
+  }
+
+  void count( Counter counter, long n )
+  {
+    counters[counter] += n;
+  }
+
+  double secondsSinceOrigin( const std::chrono::steady_clock::time_point& time ) const
+  {
+    return std::chrono::duration<double>( time - origin ).count();
+  }
+
+  void addStage( const std::string& name, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end )
+  {
+    Stage stage = { name, secondsSinceOrigin( start ), std::chrono::duration<double>( end - start ).count() };
+    std::lock_guard<std::mutex> lock( mutex );
+    stages.push_back( stage );
+  }
+
+  std::string json() // one line, stages ordered by their start
+  {
+    const char* names[COUNTER_COUNT] = { "shooting_evaluations", "poincare_map_calls", "face_boxes", "subsegments", "newton_iterations" };
+
+    std::vector<Stage> ordered;
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      ordered = stages;
+    }
+    std::stable_sort( ordered.begin(), ordered.end(), []( const Stage& a, const Stage& b ){ return a.start < b.start; } );
+
+    std::ostringstream text;
+    text.precision(9);
+    text << "{\"counters\":{";
+    for( int c = 0; c < COUNTER_COUNT; c++ )
+      text << ( c ? "," : "" ) << "\"" << names[c] << "\":" << counters[c];
+    text << "},\"stages\":[";
+    for( unsigned int k = 0; k < ordered.size(); k++ )
+      text << ( k ? "," : "" ) << "{\"name\":\"" << ordered[k].name << "\",\"start\":" << ordered[k].start << ",\"seconds\":" << ordered[k].seconds << "}";
+    text << "]}";
+    return text.str();
+  }
+};
+
+void FhnCount( FhnInstrumentation* instrumentation, FhnInstrumentation::Counter counter, long n ) // does nothing without instrumentation
+{
+  if( instrumentation )
+    instrumentation->count( counter, n );
+}
+
+class FhnStageTimer           // records the time from its construction to its destruction (also by an exception) as a stage, does nothing without instrumentation
+{
+public:
+  FhnInstrumentation* instrumentation;
+  const char* name;
+  std::chrono::steady_clock::time_point start;
+
+  FhnStageTimer( FhnInstrumentation* _instrumentation, const char* _name ) : instrumentation( _instrumentation ), name( _name )
+  {
+    if( instrumentation )
+      start = std::chrono::steady_clock::now();
+  }
+
+  ~FhnStageTimer()
+  {
+    if( instrumentation )
+      instrumentation->addStage( name, start, std::chrono::steady_clock::now() );
+  }
+};
@@ -11,6 +11,73 @@
  * and the fast reversed vector field given in the class FhnBifurcation
  * ----------------------------------------------------------------------------------------*/
 
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+/* ----------------------------------------------------------------------------------------- */
+/* ---------------------------- SLOW MANIFOLD POINTS --------------------------------------- */
+/* ----------------------------------------------------------------------------------------- */
+
+// equilibria of the fast subsystem (w = 0) for a given v are the zeroes of the cubic u*(u-1)*(u-1/10) + v = u^3 - 11/10 u^2 + 1/10 u + v
+// (the theta*w term vanishes at w = 0), the same by hand written cubic as in FhnBifurcation and vectorfield.hpp has to be changed with the vector field
+
+const int slowManifoldNewtonCap = 100;    // Newton iterations after which FhnSlowManifoldPoints gives up
+
+int FhnSlowManifoldPoints( std::vector<double>& u, const std::vector<double>& v )
+  // corrects guesses u[k] of zeroes of the cubic for v[k] by Newton's method with the closed-form derivative 3u^2 - 11/5 u + 1/10, all points together
+  // four at a time with AVX2 (one at a time if the compiler does not target AVX2) until every step is below accuracy; returns the number of iterations,
+  // throws if some point is no longer finite (e.g. the derivative vanished at a guess near a fold) or the points do not converge within slowManifoldNewtonCap iterations
+{
+  size_t count( u.size() );
+
+  for( int iteration = 1; iteration <= slowManifoldNewtonCap; iteration++ )
+  {
+    size_t unconverged( 0 );      // steps which are not below accuracy, NaN steps are counted as well
+    bool finite( 1 );
+    size_t k( 0 );
+
+#ifdef __AVX2__
+    __m256d signMask = _mm256_set1_pd( -0. );
+    __m256d accuracy4 = _mm256_set1_pd( accuracy );
+    __m256d zero = _mm256_setzero_pd();
+    for( ; k + 4 <= count; k += 4 )
+    {
+      __m256d x = _mm256_loadu_pd( &u[k] );
+      __m256d value = _mm256_add_pd( _mm256_mul_pd( _mm256_add_pd( _mm256_mul_pd( _mm256_sub_pd( x, _mm256_set1_pd( 1.1 ) ), x ), _mm256_set1_pd( 0.1 ) ), x ),
+                                     _mm256_loadu_pd( &v[k] ) );
+      __m256d derivative = _mm256_add_pd( _mm256_mul_pd( _mm256_sub_pd( _mm256_mul_pd( _mm256_set1_pd( 3. ), x ), _mm256_set1_pd( 2.2 ) ), x ), _mm256_set1_pd( 0.1 ) );
+      __m256d step = _mm256_div_pd( value, derivative );
+      __m256d next = _mm256_sub_pd( x, step );
+      _mm256_storeu_pd( &u[k], next );
+      unconverged += 4 - __builtin_popcount( _mm256_movemask_pd( _mm256_cmp_pd( _mm256_andnot_pd( signMask, step ), accuracy4, _CMP_LE_OQ ) ) );
+      finite = finite && _mm256_movemask_pd( _mm256_cmp_pd( _mm256_sub_pd( next, next ), zero, _CMP_EQ_OQ ) ) == 0xF;   // x - x is NaN for infinite x
+    }
+#endif
+
+    for( ; k < count; k++ )
+    {
+      double x( u[k] );
+      double step( ( ( ( x - 1.1 )*x + 0.1 )*x + v[k] )/( ( 3.*x - 2.2 )*x + 0.1 ) );
+      u[k] = x - step;
+      unconverged += !( std::abs( step ) <= accuracy );
+      finite = finite && std::isfinite( u[k] );
+    }
+
+    if( !finite )
+      throw "NEWTON CORRECTION OF SLOW MANIFOLD POINTS DIVERGED! \n";
+    if( unconverged == 0 )
+      return iteration;
+  }
+
+  throw "NEWTON CORRECTION OF SLOW MANIFOLD POINTS DOES NOT CONVERGE! \n";
+}
+
 
 /* ----------------------------------------------------------------------------------------- */
 /* ---------------------------- FAST SUBSYSTEM NUMERICS ------------------------------------ */
@@ -30,6 +97,9 @@ public:
   DPoincareMap pm;
   DPoincareMap pmRev;     // reversed Poincare map for backward integration
   bool dir;               // direction - do we go from EqU to EqD or other way round?
+  enum RootFinder { SECANT, ILLINOIS };
+  RootFinder rootFinder;  // method used by v_correct
+  int evaluationCount;    // number of calls of w_function (i.e. pairs of integrations) in the last v_correct
   FhnBifurcation (int order, double& _theta, const DVector& _EqU, const DVector& _EqD, double _DISP, bool _dir = 1) 
     : vectorField("par:theta,v;var:u,w;fun:w,(2/10)*(theta*w+u*(u-1)*(u-(1/10))+v);"), // vector field is u'=w, w'=0.2*(theta*w +u*(u-1)*(u-0.1)+v, v is parameter
       vectorFieldRev("par:theta,v;var:u,w;fun:-w,(-2/10)*(theta*w+u*(u-1)*(u-(1/10))+v);"), //  minus vector field for reverse integration
@@ -41,7 +111,9 @@ public:
       section( DVector({0.2, 0. }), DVector({-1.,0.})), // an arbitrary choice of coordinate section here
       pm(solver,section),
       pmRev(solverRev,section),
-      dir(_dir)
+      dir(_dir),
+      rootFinder(SECANT),
+      evaluationCount(0)
   {
     vectorField.setParameter("theta",_theta);
     vectorFieldRev.setParameter("theta",_theta);
@@ -49,19 +121,11 @@ public:
 
   DVector Eq_correct(DVector& guess, double v)              // corrects initial guesses of u so they are closer to real equilibria, w is always 0
   {
-    vectorField.setParameter("v", v);
-    double error = 1.;
-    double result = guess[0];
-    double oldresult = result;
-    while(error > accuracy)
-    {
-      oldresult = result;
-      result = result - ( vectorField(DVector({result, 0.}) )[1] / vectorField[ DVector({result, 0.}) ][1][0] );  // Newton algorithm to calculate zeroes of the vector field - w is always 0.,
-                                                                                                                  // derivative is of the second equation wr. to first variable - u
-      error = abs(oldresult - result);
-    }
+    std::vector<double> result( 1, guess[0] );
+    FhnSlowManifoldPoints( result, std::vector<double>( 1, v ) );   // Newton algorithm to calculate zeroes of the vector field - w is always 0., 
+                                                                    // (second equation divided by 2/10, closed-form derivative with respect to u)
     DVector new_Eq(2);
-    new_Eq[0] = result;
+    new_Eq[0] = result[0];
     new_Eq[1] = 0.;
     return new_Eq;
   }
@@ -108,40 +172,60 @@ public:
   }
 
   double v_correct(double v) // secant method to correct v to the bifurcation point, as side effect corrects equilibria EqU and EqD to right positions 
+                             // values of w_function are carried over between iterations, so each iteration integrates once; with ILLINOIS the iterates
+                             // keep a bracket once they have one (regula falsi with the Illinois modification), which cannot diverge like the plain secant method
   {
-    double error = 1.;
-
     double v0 = v + 1e-4;
     double v1 = v;
-    double v_temp = v;
 
-    DVector EqU0 = Eq_correct(EqU, v0);
     DVector EqU1 = Eq_correct(EqU, v1);
-    DVector EqD0 = Eq_correct(EqD, v0);
     DVector EqD1 = Eq_correct(EqD, v1);
 
-   while(error > accuracy)
-   {
-    v_temp = v1;
-    v1 = v1 - w_function(EqU1, EqD1, v1)*( (v1-v0) / ( w_function(EqU1, EqD1, v1) - w_function(EqU0, EqD0, v0) ) );
-    EqU0 = Eq_correct( EqU0, v_temp );
-    EqD0 = Eq_correct( EqD0, v_temp );
-    EqU1 = Eq_correct( EqU1, v1 );
-    EqD1 = Eq_correct( EqD1, v1 );
-    v0 = v_temp;
-
-    error = abs( w_function(EqU1, EqD1, v1) );
-   }
-
-   EqU = EqU1;
-   EqD = EqD1;
-    
-   return v1;
+    double w0 = w_function( Eq_correct(EqU, v0), Eq_correct(EqD, v0), v0 );
+    double w1 = w_function( EqU1, EqD1, v1 );
+    evaluationCount = 2;
+
+    while( abs(w1) > accuracy )
+    {
+      double v2 = v1 - w1*( (v1-v0) / (w1-w0) );
+      DVector EqU2 = Eq_correct( EqU1, v2 );
+      DVector EqD2 = Eq_correct( EqD1, v2 );
+      double w2 = w_function( EqU2, EqD2, v2 );
+      evaluationCount++;
+
+      if( rootFinder == ILLINOIS && w0*w1 < 0. )   // the root is between v0 and v1
+      {
+        if( w2*w1 < 0. )                         // now it is between v1 and v2
+        {
+          v0 = v1;
+          w0 = w1;
+        }
+        else                                     // v0 is kept again, halving its value avoids slow one-sided convergence of regula falsi
+          w0 /= 2.;
+      }
+      else
+      {
+        v0 = v1;
+        w0 = w1;
+      }
+
+      v1 = v2;
+      w1 = w2;
+      EqU1 = EqU2;
+      EqD1 = EqD2;
+    }
+
+    EqU = EqU1;
+    EqD = EqD1;
+      
+    return v1;
   }
 };
 
 
-void GammaQuad_correct( const interval& _theta, IVector& _GammaUL, IVector& _GammaDL, IVector& _GammaUR, IVector& _GammaDR ) // corrects original guesses of Gammas for given theta
+int GammaQuad_correct( const interval& _theta, IVector& _GammaUL, IVector& _GammaDL, IVector& _GammaUR, IVector& _GammaDR, 
+                       FhnBifurcation::RootFinder _rootFinder = FhnBifurcation::SECANT ) // corrects original guesses of Gammas for given theta,
+                                                                                         // returns the number of w_function evaluations used
 {
   double theta( _theta.leftBound() );
   double DISP(1e-12);
@@ -167,6 +251,7 @@ void GammaQuad_correct( const interval& _theta, IVector& _GammaUL, IVector& _Gam
 
   FhnBifurcation BifR(order, theta, EqUR, EqDR, DISP);
   FhnBifurcation BifL(order, theta, EqUL, EqDL, DISP, 0); 
+  BifR.rootFinder = BifL.rootFinder = _rootFinder;
 
   double vR_c( BifR.v_correct(vR) );        // corrected v values & equlibria coordinates
   double vL_c( BifL.v_correct(vL) );
@@ -190,5 +275,64 @@ void GammaQuad_correct( const interval& _theta, IVector& _GammaUL, IVector& _Gam
 
   _GammaUL[2] = _GammaDL[2] = vL_c;
   _GammaUR[2] = _GammaDR[2] = vR_c;
+
+  return BifR.evaluationCount + BifL.evaluationCount;
 }
 
+
+
+
+/* ----------------------------------------------------------------------------------------- */
+/* ---------------------------- CONTINUATION IN THETA -------------------------------------- */
+/* ----------------------------------------------------------------------------------------- */
+
+class FhnCornerCache    // corrected corner points of recently verified theta values, used to predict the initial guesses of GammaQuad_correct
+                        // for nearby theta (continuation along theta sweeps); can be shared between threads, then which theta values are remembered
+                        // when a prediction is made depends on the order in which the verifications finish
+{
+public:
+  std::map<double, DVector> corners;   // theta -> ( u of GammaUL, GammaDL, GammaUR, GammaDR, vL, vR ), w of corner points is always 0
+  std::mutex mutex;
+  int capacity;                        // maximal number of remembered theta values
+
+  FhnCornerCache( int _capacity = 16 ) : capacity( _capacity ) {}
+
+  bool predict( double theta, DVector& _corners ) // linear extrapolation (or interpolation) from the two remembered theta values nearest to theta, 
+                                                  // the nearest one only if there is just one or it is theta itself; returns 0 if nothing is remembered
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    if( corners.empty() )
+      return 0;
+
+    std::map<double, DVector>::iterator first( corners.end() ), second( corners.end() );
+    for( std::map<double, DVector>::iterator it = corners.begin(); it != corners.end(); ++it )
+    {
+      if( first == corners.end() || std::fabs( it->first - theta ) < std::fabs( first->first - theta ) )
+      {
+        second = first;
+        first = it;
+      }
+      else if( second == corners.end() || std::fabs( it->first - theta ) < std::fabs( second->first - theta ) )
+        second = it;
+    }
+
+    if( second == corners.end() || first->first == theta )
+      _corners = first->second;
+    else
+      _corners = first->second + ( second->second - first->second )*( ( theta - first->first )/( second->first - first->first ) );
+    return 1;
+  }
+
+  void store( double theta, const DVector& _corners ) // if the cache is full, the remembered theta value farthest from theta is forgotten
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    corners[theta] = _corners;
+
+    while( int( corners.size() ) > capacity )
+    {
+      std::map<double, DVector>::iterator farthest( std::fabs( corners.begin()->first - theta ) > std::fabs( corners.rbegin()->first - theta ) ? 
+                                                    corners.begin() : --corners.end() );     // keys are ordered, so the farthest one is at one of the ends
+      corners.erase( farthest );
+    }
+  }
+};
@@ -0,0 +1,268 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing auxiliaries for distributing independent parts
+ * of the proof (cells of subdivided h-sets, subsegments, ...) among several threads.
+ * CAPD maps and solvers keep internal buffers and are not thread-safe, so each worker
+ * gets its own index and is expected to use its own copies of them.
+ * TaskGraph runs larger stages of the proof which depend on results of each other.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <string>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- PARALLEL LOOPS ---------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+int threadCount( int _threads )   // number of worker threads to use, 0 means as many as the hardware supports
+{
+  if( _threads > 0 )
+    return _threads;
+
+  int hardwareThreads( std::thread::hardware_concurrency() );
+  return ( hardwareThreads > 0 ? hardwareThreads : 1 );
+}
+
+template<typename Task>
+void parallelFor( int _count, int _threads, Task task )  // calls task( worker, k ) for k = 0, ..., _count-1 using _threads workers numbered 0, ..., _threads-1
+                                                          // k's are handed out dynamically; the first exception thrown by a task (e.g. const char* messages
+                                                          // of the proof) stops handing out new k's and is rethrown in the calling thread
+{
+  if( _threads <= 1 || _count <= 1 )
+  {
+    for( int k = 0; k < _count; k++ )
+      task( 0, k );
+    return;
+  }
+
+  int workerCount( _threads < _count ? _threads : _count );
+  std::atomic<int> next( 0 );
+  std::atomic<bool> failed( false );
+  std::vector<std::exception_ptr> errors( workerCount );
+  std::vector<std::thread> workers;
+
+  for( int w = 0; w < workerCount; w++ )
+  {
+    workers.push_back( std::thread( [&, w]()
+    {
+      try
+      {
+        int k;
+        while( !failed && ( k = next++ ) < _count )
+          task( w, k );
+      }
+      catch(...)
+      {
+        errors[w] = std::current_exception();
+        failed = true;
+      }
+    } ) );
+  }
+
+  for( int w = 0; w < workerCount; w++ )
+    workers[w].join();
+
+  for( int w = 0; w < workerCount; w++ )
+    if( errors[w] )
+      std::rethrow_exception( errors[w] );
+}
+
+template<typename Item>
+class WorkQueue          // items of parallelWorkQueue, tasks may add new ones
+{
+public:
+  std::deque<Item> items;
+  std::mutex mutex;
+  std::condition_variable changed;
+  int running;           // number of tasks being executed
+  bool failed;
+
+  WorkQueue( const std::vector<Item>& _items ) : items( _items.begin(), _items.end() ), running( 0 ), failed( 0 ) {}
+
+  void push( const Item& item )
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    items.push_back( item );
+    changed.notify_one();
+  }
+};
+
+template<typename Item, typename Task>
+void parallelWorkQueue( const std::vector<Item>& _items, int _threads, Task task ) // calls task( worker, item, queue ) for all items using _threads workers
+                                                                                  // a task may add new items by queue.push( item ), workers finish when the queue
+                                                                                  // is empty and no task is running; exceptions are handled as in parallelFor
+{
+  WorkQueue<Item> queue( _items );
+
+  int workerCount( _threads > 1 ? _threads : 1 );
+  std::vector<std::exception_ptr> errors( workerCount );
+  std::vector<std::thread> workers;
+
+  for( int w = 0; w < workerCount; w++ )
+  {
+    workers.push_back( std::thread( [&, w]()
+    {
+      while( 1 )
+      {
+        Item item;
+        {
+          std::unique_lock<std::mutex> lock( queue.mutex );
+          queue.changed.wait( lock, [&](){ return queue.failed || !queue.items.empty() || queue.running == 0; } );
+          if( queue.failed || queue.items.empty() )
+            return;                                     // nothing is queued and nothing is running, so nothing more will be queued
+          item = queue.items.front();
+          queue.items.pop_front();
+          queue.running++;
+        }
+
+        try
+        {
+          task( w, item, queue );
+        }
+        catch(...)
+        {
+          errors[w] = std::current_exception();
+          std::lock_guard<std::mutex> lock( queue.mutex );
+          queue.failed = 1;
+        }
+
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        queue.running--;
+        queue.changed.notify_all();
+      }
+    } ) );
+  }
+
+  for( int w = 0; w < workerCount; w++ )
+    workers[w].join();
+
+  for( int w = 0; w < workerCount; w++ )
+    if( errors[w] )
+      std::rethrow_exception( errors[w] );
+}
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- TASK GRAPHS ------------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class TaskGraph          // tasks exchanging results through variables of the caller, each task is run once all tasks it depends on have finished
+{
+public:
+  struct Task
+  {
+    std::string name;
+    std::vector<int> dependencies;   // indices of tasks whose outputs are inputs of this one, always added earlier
+    std::function<void()> run;
+  };
+
+  std::vector<Task> tasks;
+
+  int add( const std::string& _name, const std::vector<int>& _dependencies, const std::function<void()>& _run ) // returns the index of the task for dependencies of later tasks
+  {
+    for( unsigned int d = 0; d < _dependencies.size(); d++ )
+      if( _dependencies[d] < 0 || _dependencies[d] >= int( tasks.size() ) )
+        throw "TASK GRAPH ERROR! \n";                               // dependencies have to be added first, so the graph has no cycles
+
+    Task task = { _name, _dependencies, _run };
+    tasks.push_back( task );
+    return tasks.size() - 1;
+  }
+
+  void run( int _threads ) // runs the tasks using _threads workers (in the order of adding if _threads <= 1), ready tasks are started in the order of adding;
+                           // after a task throws no further tasks are started, and once the running ones finish the exception of the failed task
+                           // added first is rethrown
+  {
+    int count( tasks.size() );
+    std::vector<std::exception_ptr> errors( count );
+
+    if( _threads <= 1 )
+    {
+      for( int k = 0; k < count; k++ )
+        tasks[k].run();
+      return;
+    }
+
+    std::vector<int> waitingFor( count );           // number of unfinished dependencies
+    std::vector< std::vector<int> > dependents( count );
+    std::deque<int> ready;
+    for( int k = 0; k < count; k++ )
+    {
+      waitingFor[k] = tasks[k].dependencies.size();
+      for( unsigned int d = 0; d < tasks[k].dependencies.size(); d++ )
+        dependents[ tasks[k].dependencies[d] ].push_back( k );
+      if( waitingFor[k] == 0 )
+        ready.push_back( k );
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    int running( 0 );
+    bool failed( 0 );
+
+    int workerCount( _threads < count ? _threads : count );
+    std::vector<std::thread> workers;
+
+    for( int w = 0; w < workerCount; w++ )
+    {
+      workers.push_back( std::thread( [&]()
+      {
+        while( 1 )
+        {
+          int k;
+          {
+            std::unique_lock<std::mutex> lock( mutex );
+            changed.wait( lock, [&](){ return failed || !ready.empty() || running == 0; } );
+            if( failed || ready.empty() )
+              return;                                   // nothing is ready and nothing is running, so all tasks have finished
+            k = ready.front();
+            ready.pop_front();
+            running++;
+          }
+
+          std::exception_ptr error;
+          try
+          {
+            tasks[k].run();
+          }
+          catch(...)
+          {
+            error = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> lock( mutex );
+          running--;
+          if( error )
+          {
+            errors[k] = error;
+            failed = 1;
+          }
+          else
+            for( unsigned int d = 0; d < dependents[k].size(); d++ )
+              if( --waitingFor[ dependents[k][d] ] == 0 )
+              {
+                std::deque<int>::iterator position( ready.begin() );   // keeps ready tasks in the order of adding
+                while( position != ready.end() && *position < dependents[k][d] )
+                  ++position;
+                ready.insert( position, dependents[k][d] );
+              }
+          changed.notify_all();
+        }
+      } ) );
+    }
+
+    for( int w = 0; w < workerCount; w++ )
+      workers[w].join();
+
+    for( int k = 0; k < count; k++ )
+      if( errors[k] )
+        std::rethrow_exception( errors[k] );
+  }
+};
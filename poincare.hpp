@@ -5,6 +5,7 @@
  * 2-dim covering relations.
  * ----------------------------------------------------------------------------------------*/
 
+#include <queue>
 
 
 
@@ -16,32 +17,28 @@
 
 IVector leftU(const IVector &N)
 {
-  IVector _leftU( N.dimension() ); 
-  _leftU = N;
+  IVector _leftU( N );
   _leftU[1] =  N[1].leftBound();
   return _leftU;
 }
 
 IVector rightU(const IVector &N)
 {
-  IVector _rightU( N.dimension() );
-  _rightU = N;
+  IVector _rightU( N );
   _rightU[1] =  N[1].rightBound();
   return _rightU;
 }
 
 IVector leftS(const IVector &N)
 {
-  IVector _leftS( N.dimension() ); 
-  _leftS = N;
+  IVector _leftS( N );
   _leftS[0] =  N[0].leftBound();
   return _leftS;
 }
 
 IVector rightS(const IVector &N)
 {
-  IVector _rightS( N.dimension() );
-  _rightS = N;
+  IVector _rightS( N );
   _rightS[0] =  N[0].rightBound();
   return _rightS;
 }
@@ -85,6 +82,119 @@ IVector shrinkAndExpand(IVector &N, interval factor)  // shrinks a rectangle in
 
 
 
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- ADAPTIVE SUBDIVISION ---------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+struct AdaptiveCell   // a cell ti x tj of the square [0,1]^2 parametrizing a 2-dim h-set together with the enclosure of its 2-dim image
+{
+  interval ti;
+  interval tj;
+  IVector image;
+  double width;       // the larger of the widths of the two coordinates of the image
+
+  bool operator<( const AdaptiveCell& other ) const { return width < other.width; }
+};
+
+struct CoveringGoal   // the covering condition on the image of a set: its coordinate is below -EPS (sign -1) or above EPS (sign 1), as for images of edges of h-sets;
+                      // sign 0 - no condition, e.g. for images of whole h-sets, which only enter coverings through their hulls
+{
+  int coordinate;
+  int sign;
+
+  bool decided( const IVector& image ) const   // whether the image of a cell already satisfies the condition, its subcells need not be refined then
+  {
+    if( sign < 0 )
+      return image[coordinate] + EPS < 0.;
+    return image[coordinate] - EPS > 0.;
+  }
+};
+
+const CoveringGoal noCoveringGoal = { 0, 0 };
+
+const int adaptiveSplitsPerBatch = 16;   // cells split before their children are evaluated together, fixed so that the cells do not depend on the number of threads
+
+template<typename Evaluate>
+IVector adaptiveImage( int _disc_i, int _disc_j, bool _split_i, bool _split_j, int _budget, const CoveringGoal& _goal, double _tolerance, int _threads, 
+                       Evaluate evaluate, int& _cellCount )
+  // starts from the uniform _disc_i x _disc_j grid and repeatedly bisects the cells with the widest images (in directions i and/or j, as allowed by _split_i, _split_j)
+  // among those which are still undecided: with a covering goal the cells whose images do not satisfy its condition yet, otherwise the cells whose images
+  // are wider than _tolerance (0 - none), until no cell is undecided or further splitting would exceed _budget cells; evaluate( worker, ti, tj ) returns the image
+  // of cell ti x tj, cells are evaluated by _threads workers, adaptiveSplitsPerBatch cells are split at a time. Returns the hull of the images of the final cells,
+  // their number is stored in _cellCount
+{
+  std::priority_queue<AdaptiveCell> undecided;   // widest image on top
+  std::vector<AdaptiveCell> decided;             // cells which are not split any more
+  std::vector<AdaptiveCell> batch;               // cells waiting for evaluation
+
+  for(int i=1; i<=_disc_i; i++)
+    for(int j=1; j<=_disc_j; j++)
+    {
+      AdaptiveCell cell;
+      cell.ti = interval(i-1, i)/_disc_i;
+      cell.tj = interval(j-1, j)/_disc_j;
+      batch.push_back( cell );
+    }
+
+  int children( ( _split_i ? 2 : 1 )*( _split_j ? 2 : 1 ) );
+
+  while( !batch.empty() )
+  {
+    parallelFor( batch.size(), _threads, [&]( int w, int k )
+    {
+      batch[k].image = evaluate( w, batch[k].ti, batch[k].tj );
+    } );
+
+    for( unsigned int k = 0; k < batch.size(); k++ )   // in the order of the batch, so the queue does not depend on the order of evaluation
+    {
+      double width0( batch[k].image[0].rightBound() - batch[k].image[0].leftBound() ),
+             width1( batch[k].image[1].rightBound() - batch[k].image[1].leftBound() );
+      batch[k].width = ( width0 > width1 ? width0 : width1 );
+
+      if( _goal.sign != 0 ? !_goal.decided( batch[k].image ) : batch[k].width > _tolerance && _tolerance > 0. )
+        undecided.push( batch[k] );
+      else
+        decided.push_back( batch[k] );
+    }
+    batch.clear();
+
+    for( int s = 0; s < adaptiveSplitsPerBatch && children > 1 && !undecided.empty()
+                    && int( undecided.size() + decided.size() + batch.size() ) + children - 1 <= _budget; s++ )
+    {
+      AdaptiveCell parent( undecided.top() );
+      undecided.pop();
+
+      double mid_i( ( parent.ti.leftBound() + parent.ti.rightBound() )/2. ),   // the halves share the split point, so they still cover the parent exactly
+             mid_j( ( parent.tj.leftBound() + parent.tj.rightBound() )/2. );
+
+      for(int a=0; a < ( _split_i ? 2 : 1 ); a++)
+        for(int b=0; b < ( _split_j ? 2 : 1 ); b++)
+        {
+          AdaptiveCell child;
+          child.ti = ( _split_i ? ( a == 0 ? interval( parent.ti.leftBound(), mid_i ) : interval( mid_i, parent.ti.rightBound() ) ) : parent.ti );
+          child.tj = ( _split_j ? ( b == 0 ? interval( parent.tj.leftBound(), mid_j ) : interval( mid_j, parent.tj.rightBound() ) ) : parent.tj );
+          batch.push_back( child );
+        }
+    }
+  }
+
+  while( !undecided.empty() )   // cells left undecided when the budget ran out
+  {
+    decided.push_back( undecided.top() );
+    undecided.pop();
+  }
+  _cellCount = decided.size();
+
+  IVector resultArr( decided[0].image );
+  for( size_t k = 1; k < decided.size(); k++ )   // the cells only depend on their images, not on the number of threads
+  {
+    resultArr[0] = intervalHull(resultArr[0], decided[k].image[0]);
+    resultArr[1] = intervalHull(resultArr[1], decided[k].image[1]);
+  }
+  return resultArr;
+}
+
+
 /* ------------------------------------------------------------------------------------ */
 /* ---------------------------- POINCARE MAPS ----------------------------------------- */
 /* ------------------------------------------------------------------------------------ */
@@ -103,13 +213,19 @@ public:
   IPoincareMap pm;
   IMatrix P1;
   IMatrix P2;
+  IMatrix InvP2;    // P2^(-1), see prepare
   int disc;         // number of subdivisions in each dimension (supports two, does not support subdivisions in parameter space) for integration of h-sets
   IVector params;   // vector of parameters
   IVector GammaU1;
   IVector GammaU2;
+  int threads;      // number of worker threads integrating cells of the subdivision, each with its own solver and Poincare map (1 - serial)
+  int cellBudget;   // if positive, the disc x disc grid is only the starting point of adaptiveImage, which refines it up to cellBudget cells (0 - uniform grid)
+  double cellTolerance;   // cells of sets without a covering goal are refined by adaptiveImage while their images are wider than this (0 - not refined)
+  int cellCount;    // number of cells used by the last call of operator() (or integrateToMidSection)
+  long cellTotal;   // number of cells used by all calls so far
 
   FhnPoincareMap( IMap _vectorField, const IMatrix& _P1, const IMatrix& _P2, const IVector& _GammaU1, const IVector& _GammaU2, 
-                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1 ) 
+                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1, int _threads=1 ) 
     : dim( 3 ),
       vectorField( _vectorField ),                               // a 3d vector field
       solver( vectorField, order ),
@@ -123,15 +239,21 @@ public:
       pm( solver, section2 ),
       P1( _P1 ),
       P2( _P2 ),
+      InvP2( inverseMatrix(P2) ),
       disc( _disc ),
       params( 1 ),
       GammaU1( _GammaU1 ),
-      GammaU2( _GammaU2 )
+      GammaU2( _GammaU2 ),
+      threads( _threads ),
+      cellBudget( 0 ),
+      cellTolerance( 0. ),
+      cellCount( 0 ),
+      cellTotal( 0 )
   {
   }
 
   FhnPoincareMap( IVector _params, IMap _vectorFieldWithParams, const IMatrix& _P1, const IMatrix& _P2, const IVector& _GammaU1, const IVector& _GammaU2, 
-                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1 ) 
+                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1, int _threads=1 ) 
     : dim( 3 + _params.dimension() ),
       vectorField( _vectorFieldWithParams ),                               
       solver( vectorField, order ),
@@ -143,10 +265,16 @@ public:
       pm ( solver, section2 ),
       P1( dim, dim ),
       P2( dim, dim ),
+      InvP2( dim, dim ),
       disc( _disc ),
       params( _params ),
       GammaU1( dim ),
-      GammaU2( dim )
+      GammaU2( dim ),
+      threads( _threads ),
+      cellBudget( 0 ),
+      cellTolerance( 0. ),
+      cellCount( 0 ),
+      cellTotal( 0 )
   {
     y1vector = IVector( dim );
     y1vector.clear();                 // ensures vector is all zeroes
@@ -186,62 +314,130 @@ public:
     section1CenterVector = IVector( P1*y1vector + GammaU1 );
     section2CenterVector = IVector( P2*y2vector + GammaU2 );
 
+    prepare();
+
     section2.setOrigin( section2CenterVector );
-    section2.setNormalVector( Transpose(inverseMatrix(P2)).column(1) );         // solver works by reference so gets autoupdated
+    section2.setNormalVector( Transpose(InvP2).column(1) );                     // solver works by reference so gets autoupdated
                                                                                // normal vector is one of the rows of inverseMatrix(P2), that matches
                                                                                // with transforming the result of Poincare map by inverseMatrix(P2)
   }
 
 
-  IVector operator()(const IVector& theSet) // we give a set in local variables on one section centered on 0 (ys & v_centered) return in variables on the other (v_centered & yu)
+  void prepare()    // computes the inverse coordinate change used by every integrated cell once per map, call again after changing P2
   {
-    IVector resultArr(2);
+    InvP2 = inverseMatrix(P2);
+  }
 
-    IMatrix P2Alt( P2 );
-    for( int k = 1; k <= dim; k++ )
-      P2Alt(k,1) = Transpose(inverseMatrix(P2))(k,1);  // we need to set the altered normal vector to the change of coordinates matrix DEPRECATED???
 
-    for(int i=1; i<=disc; i++)
+  struct Worker     // a private copy of the vector field, solver and Poincare map for one thread, CAPD objects are not thread-safe
+  {
+    IMap vectorField;
+    ITaylor solver;
+    IAffineSection section;
+    IPoincareMap pm;
+
+    Worker( const IMap& _vectorField, const IAffineSection& _section )
+      : vectorField( _vectorField ),
+        solver( vectorField, order ),
+        section( _section ),
+        pm( solver, section )
     {
-      int disc1;
-      if( theSet[0].leftBound() == theSet[0].rightBound() )   // check whether we integrate one of the unstable edges of an h-set
-        disc1=1;
-      else 
-        disc1=disc;
- 
-      interval ti = interval(i-1, i)/disc;
+    }
+  };
+
+  std::vector< std::unique_ptr<Worker> > workers;    // per-thread copies for operator(), created by the first parallel call and reused by later ones
 
-      for(int j=1; j<=disc1; j++)
+
+  static void ensureWorkers( std::vector< std::unique_ptr<Worker> >& _workers, int _count, const IMap& _vectorField, const IAffineSection& _section )
+                    // extends a pool of workers to _count of them, setting up a solver allocates its Taylor coefficient buffers so it is done once per thread
+  {
+    while( int( _workers.size() ) < _count )
+      _workers.push_back( std::unique_ptr<Worker>( new Worker( _vectorField, _section ) ) );
+  }
+
+
+  IVector cellImage( IPoincareMap& _pm, const IVector& theSet, interval ti, interval tj ) // integrates one cell (ti,tj) of the subdivision of theSet, returns it in coordinates on section 2
+  {
+    IVector Set_ij( dim ); // the centered part of the set with expanded directions
+    Set_ij.clear();        
+
+    Set_ij[0] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of ys coordinate
+    Set_ij[2] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of v coordinate
+
+  /*  if( dim > 3 )  // checks whether we have parameters
+        for( int k=3; k < dim; k++ )
+          Set_ij[k] = 0.; // params[k-3];      // we embed parameters  */ // this part of code is probably deprecated since we embedded the parameters in the constructor
+
+    C0Rect2Set setAff( section1CenterVector, P1, Set_ij ); // the set moved to default space, observe that parameters remain unchanged
+
+    interval returntime(0.);
+    return _pm( setAff, GammaU2, InvP2, returntime );             // result is moved back to local coordinates, ys should be close to 0 
+                                                                 // in other words P2^-1( PM(setAff) - GammaU2 ) is computed 
+                                                                 //  IMPORTANT: I NEED TO CHANGE HERE TO GAMMA2?
+  }
+
+
+  IVector operator()(const IVector& theSet, const CoveringGoal& goal = noCoveringGoal) // we give a set in local variables on one section centered on 0 (ys & v_centered) return in variables on the other (v_centered & yu)
+                                                                                     // with cellBudget cells are refined until their images satisfy goal (see adaptiveImage)
+  {
+    IVector resultArr(2);
+
+    if( cellBudget > 0 )
+    {
+      if( threads > 1 )
+        ensureWorkers( workers, threads, vectorField, section2 );
+
+      bool split_i( theSet[0].leftBound() != theSet[0].rightBound() ),     // ti subdivides ys, tj subdivides v
+           split_j( theSet[1].leftBound() != theSet[1].rightBound() );
+
+      IVector image( adaptiveImage( split_i ? disc : 1, split_j ? disc : 1, split_i, split_j, cellBudget, goal, cellTolerance, threads, [&]( int w, interval ti, interval tj )
       {
-        interval tj = interval(j-1, j)/disc1;
+        IVector cellResult( cellImage( threads > 1 ? workers[w]->pm : pm, theSet, ti, tj ) ), result(2);
+        result[0] = cellResult[2];
+        result[1] = cellResult[1];
+        return result;
+      }, cellCount ) );
+      cellTotal += cellCount;
+      return image;
+    }
 
-        IVector Set_ij( dim ); // the centered part of the set with expanded directions
-        Set_ij.clear();        
+    int disc1;
+    if( theSet[0].leftBound() == theSet[0].rightBound() )   // check whether we integrate one of the unstable edges of an h-set
+      disc1=1;
+    else 
+      disc1=disc;
+    cellCount = disc*disc1;
+    cellTotal += cellCount;
 
-        Set_ij[0] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of ys coordinate
-        Set_ij[2] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of v coordinate
+    std::vector<IVector> cellResults( disc*disc1 );         // cell (i,j) is stored at (i-1)*disc1 + (j-1)
+    int workerCount( threads < disc*disc1 ? threads : disc*disc1 );
 
-  /*      if( dim > 3 )  // checks whether we have parameters
-          for( int k=3; k < dim; k++ )
-            Set_ij[k] = 0.; // params[k-3];      // we embed parameters  */ // this part of code is probably deprecated since we embedded the parameters in the constructor
+    if( workerCount <= 1 )
+    {
+      for( int k = 0; k < disc*disc1; k++ )
+        cellResults[k] = cellImage( pm, theSet, interval(k/disc1, k/disc1 + 1)/disc, interval(k%disc1, k%disc1 + 1)/disc1 );
+    }
+    else
+    {
+      ensureWorkers( workers, workerCount, vectorField, section2 );
 
-        C0Rect2Set setAff( section1CenterVector, P1, Set_ij ); // the set moved to default space, observe that parameters remain unchanged
+      parallelFor( disc*disc1, workerCount, [&]( int w, int k )
+      {
+        cellResults[k] = cellImage( workers[w]->pm, theSet, interval(k/disc1, k/disc1 + 1)/disc, interval(k%disc1, k%disc1 + 1)/disc1 );
+      } );
+    }
 
-        interval returntime(0.);
-        IVector result = pm( setAff, GammaU2, inverseMatrix(P2), returntime ); // result is moved back to local coordinates, ys should be close to 0 
-                                                                                            // in other words P2Alt^-1( PM(setAff) - section2center ) is computed 
-                                                                                            // where section2center = _P2&y2vector + _GammaU2
-                                                                                            //  IMPORTANT: I NEED TO CHANGE HERE TO GAMMA2?
-        if( i==1 && j==1)
-        {
-          resultArr[0] = result[2];   // being on a section given by ys we only return v,yu coordinates, now v is the stable
-          resultArr[1] = result[1];  
-        }
-        else
-        {
-          resultArr[0] = intervalHull(resultArr[0], result[2]);
-          resultArr[1] = intervalHull(resultArr[1], result[1]);
-        }
+    for( int k = 0; k < disc*disc1; k++ )   // the hull is always taken in the same order, so the result does not depend on the number of threads
+    {
+      if( k == 0 )
+      {
+        resultArr[0] = cellResults[k][2];   // being on a section given by ys we only return v,yu coordinates, now v is the stable
+        resultArr[1] = cellResults[k][1];  
+      }
+      else
+      {
+        resultArr[0] = intervalHull(resultArr[0], cellResults[k][2]);
+        resultArr[1] = intervalHull(resultArr[1], cellResults[k][1]);
       }
     }
     return resultArr; 
@@ -263,20 +459,31 @@ class midPoincareMap : public FhnPoincareMap
 public:
   IVector midCenterVector;
   IMatrix midP;
+  IMatrix InvMidP;  // midP^(-1), see prepare
   IAffineSection midSection;
   IMap vectorFieldRev;
+  ITaylor solverRev;
+  IPoincareMap midPM;       // from section 1 forward to midSection, shares the solver of FhnPoincareMap
+  IPoincareMap midPMRev;    // from section 2 backward to midSection
+  std::vector< std::unique_ptr<Worker> > midWorkers, midWorkersRev;   // per-thread copies of the two for parallel integrateToMidSection, reused across calls
+  std::ostream* log;        // diagnostic output of the construction and of checkCovering (0 - none, e.g. when several proofs run concurrently)
   
   midPoincareMap( IMap _vectorField, IMap _vectorFieldRev, const IMatrix& _P1, const IMatrix& _P2, const IVector& _GammaU1, const IVector& _GammaU2, 
-                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1 ) 
-  : FhnPoincareMap( _vectorField, _P1, _P2, _GammaU1, _GammaU2, _ru1, _rs2, dir, _disc ),
+                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1, int _threads=1,
+                                                                                        std::ostream* _log = &cout ) 
+  : FhnPoincareMap( _vectorField, _P1, _P2, _GammaU1, _GammaU2, _ru1, _rs2, dir, _disc, _threads ),
     midCenterVector( dim ),
     midP( dim, dim ),
+    InvMidP( dim, dim ),
     midSection( midCenterVector, midCenterVector ),
-    vectorFieldRev( _vectorFieldRev )
+    vectorFieldRev( _vectorFieldRev ),
+    solverRev( vectorFieldRev, order ),
+    midPM( solver, midSection ),                                // midSection is set below, Poincare maps keep a reference to it
+    midPMRev( solverRev, midSection ),
+    log( _log )
   {
     ICoordinateSection tempSection( dim, 0, ( (50./100.)*_GammaU1[0] + (50./100.)*_GammaU2[0] ) ); // an auxiliary section u = ( GammaU1[0] + GammaU2[0] )/2
-    ITaylor tempSolver( vectorField, order );
-    IPoincareMap tempPM( tempSolver, tempSection );
+    IPoincareMap tempPM( solver, tempSection );
     interval returnTime;
     C0Rect2Set C0TempCenterSet( section1CenterVector );
 
@@ -284,15 +491,13 @@ public:
     midSection.setOrigin( midVector(midCenterVector) );
     midSection.setNormalVector( midVector(vectorField( midCenterVector )) );
 
-    interval returnTime2;                                       // some objects here (solver, returntime) could have been reused but for safety we create new ones
+    interval returnTime2;
     IMatrix monodromyMatrix( dim, dim );
-    ITaylor tempSolver2( vectorField, order );
     C1Rect2Set C1TempCenterSet( section1CenterVector );
 
-    IPoincareMap tempPM2( tempSolver, midSection );
-    IVector tempVect = tempPM2( C1TempCenterSet, monodromyMatrix, returnTime2 );
+    IVector tempVect = midPM( C1TempCenterSet, monodromyMatrix, returnTime2 );
 
-    midP = ( tempPM2.computeDP( tempVect, monodromyMatrix, returnTime2 ) )*P1;        // new coordinates are variational equations eval. at identity matrix times original matrix P1
+    midP = ( midPM.computeDP( tempVect, monodromyMatrix, returnTime2 ) )*P1;        // new coordinates are variational equations eval. at identity matrix times original matrix P1
                                                                                      // we cannot eval variational equations at P1 because CAPD doesn't support that yet 
                                                                                      // variational equation is linear though so that is ok
  
@@ -300,20 +505,32 @@ public:
       midP(i,2) = midVector( vectorField( midCenterVector ) )[i-1];  // we insert the section normal vector as the second column of the coordinate change matrix
                                                                      // as this was the unstable row of P1 in direction of which we integrated
                                                                      // so before the insertion this column was ~0. This should make the matrix nonsingular.
+    prepare();
+  }
+
+  void prepare()    // the same for midP, call again after changing P2 or midP
+  {
+    FhnPoincareMap::prepare();
+    InvMidP = inverseMatrix(midP);
   }
   
   midPoincareMap( IVector _params, IMap _vectorField, IMap _vectorFieldRev, const IMatrix& _P1, const IMatrix& _P2, const IVector& _GammaU1, const IVector& _GammaU2, 
-                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1 ) 
+                                                                                        interval& _ru1, interval& _rs2, interval dir = interval(1.), int _disc=1, int _threads=1,
+                                                                                        std::ostream* _log = &cout ) 
     // the same but with params treated as variables of velocity 0, same as with second constructor of FhnPoincareMap
-  : FhnPoincareMap( _params, _vectorField, _P1, _P2, _GammaU1, _GammaU2, _ru1, _rs2, dir, _disc ),  
+  : FhnPoincareMap( _params, _vectorField, _P1, _P2, _GammaU1, _GammaU2, _ru1, _rs2, dir, _disc, _threads ),  
     midCenterVector( dim ),
     midP( dim, dim ),
+    InvMidP( dim, dim ),
     midSection( midCenterVector, midCenterVector ),
-    vectorFieldRev( _vectorFieldRev )
+    vectorFieldRev( _vectorFieldRev ),
+    solverRev( vectorFieldRev, order ),
+    midPM( solver, midSection ),                                // midSection is set below, Poincare maps keep a reference to it
+    midPMRev( solverRev, midSection ),
+    log( _log )
   {
     ICoordinateSection tempSection( dim, 0, ( (50./100.)*_GammaU1[0] + (50./100.)*_GammaU2[0] ) ); // an auxiliary section u = ( GammaU1[0] + GammaU2[0] )/2
-    ITaylor tempSolver( vectorField, order );
-    IPoincareMap tempPM( tempSolver, tempSection );
+    IPoincareMap tempPM( solver, tempSection );
     interval returnTime;
     C0Rect2Set C0TempCenterSet( section1CenterVector );
 
@@ -323,13 +540,11 @@ public:
 
     interval returnTime2;
     IMatrix monodromyMatrix( dim, dim );
-    ITaylor tempSolver2( vectorField, order );                  
     C1Rect2Set C1TempCenterSet( section1CenterVector );
 
-    IPoincareMap tempPM2( tempSolver2, midSection );
-    IVector tempVect = tempPM2( C1TempCenterSet, monodromyMatrix, returnTime2 );
+    IVector tempVect = midPM( C1TempCenterSet, monodromyMatrix, returnTime2 );
 
-    midP = ( tempPM2.computeDP( tempVect, monodromyMatrix, returnTime2 ) )*P1;  
+    midP = ( midPM.computeDP( tempVect, monodromyMatrix, returnTime2 ) )*P1;  
 
     for( int i = 1; i <= dim; i++ )
     {
@@ -345,26 +560,73 @@ public:
       midP(i,2) = midVector( vectorField( midCenterVector ) )[i-1];
     }
     
-    cout << returnTime2 << "\n" << monodromyMatrix << "\n" << midP << "\n" << P1 << "\n" << inverseMatrix(midP) << "\n";
+    prepare();
+
+    if( log )
+      *log << returnTime2 << "\n" << monodromyMatrix << "\n" << midP << "\n" << P1 << "\n" << InvMidP << "\n";
   }
 
 
-  IVector integrateToMidSection( const IVector& theSet, bool dir ) // 2-dim h-set is embedded into space and integrated forward from section 1 if dir = 0 and backward from section 2 elsewise
+  IVector midCellImage( IPoincareMap& _midPM, const IVector& theSet, bool dir, interval ti, interval tj ) // integrates one cell (ti,tj) of the subdivision of theSet to midSection,
+                                                                                                         // returns its ys, v coordinates there
   {
-    ITaylor *midSolver;
-    IPoincareMap *midPM;
+    IVector Set_ij( dim ); // the centered part of the set with expanded directions
+    Set_ij.clear();        
 
     if( !dir )
-      midSolver = new ITaylor( vectorField, order );
+    {
+      Set_ij[0] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of ys coordinate
+      Set_ij[2] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of v coordinate
+    }
     else
-      midSolver = new ITaylor( vectorFieldRev, order );
+    {
+      Set_ij[2] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of v coordinate
+      Set_ij[1] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of yu coordinate
+    }
 
-    midPM = new IPoincareMap( *midSolver, midSection );
+ /*   if( dim > 3 )  // checks whether we have parameters
+      for( int k=3; k < dim; k++ )
+        Set_ij[k] = params[k-3];      // we embed parameters  DEPRECATED
+*/
+    C0Rect2Set setAff( !dir ? section1CenterVector : section2CenterVector, !dir ? P1 : P2, Set_ij ); // the set moved to default space, observe that parameters remain unchanged
+
+    interval returntime(0.);
+    IVector result = _midPM( setAff, midCenterVector, InvMidP, returntime );           // result is moved back to local coordinates, yu should be close to 0 
+                                                                                         // in other words midP^-1( PM(setAff) - midCenterVector ) is computed 
+                                                                                         // WARNING! THIS ZEROES PARAMETERS SO AS SUCH RESULT SHOULD NOT BE USED,
+                                                                                         // ONLY FIRST 3 COORDINATES OF IT (RETURNED BY THIS FUNCTION) CAN BE USED
 
     IVector resultArr(2);
- 
-    interval mtest;
+    resultArr[0] = result[0];   // midSection coordinates are given by midP - matrix P1 evolved by var. equation so similarly to P1 we project to ys, v coords, v "unstable"
+    resultArr[1] = result[2];  
+    return resultArr;
+  }
+
 
+  IVector integrateToMidSection( const IVector& theSet, bool dir, const CoveringGoal& goal = noCoveringGoal ) // 2-dim h-set is embedded into space and integrated forward from section 1 if dir = 0 
+                                                                                                         // and backward from section 2 elsewise, goal as in operator()
+  {
+    std::vector< std::unique_ptr<Worker> >& pool( !dir ? midWorkers : midWorkersRev );
+    IPoincareMap& serialPM( !dir ? midPM : midPMRev );
+
+    if( cellBudget > 0 )
+    {
+      if( threads > 1 )
+        ensureWorkers( pool, threads, ( !dir ? vectorField : vectorFieldRev ), midSection );
+
+      bool split_i( theSet[0].leftBound() != theSet[0].rightBound() ),
+           split_j( theSet[1].leftBound() != theSet[1].rightBound() );
+
+      IVector image( adaptiveImage( split_i ? disc : 1, split_j ? disc : 1, split_i, split_j, cellBudget, goal, cellTolerance, threads, [&]( int w, interval ti, interval tj )
+      {
+        return midCellImage( threads > 1 ? pool[w]->pm : serialPM, theSet, dir, ti, tj );
+      }, cellCount ) );
+      cellTotal += cellCount;
+      return image;
+    }
+
+    IVector resultArr(2);
+ 
     int disc_i;
     int disc_j;
 
@@ -378,76 +640,37 @@ public:
     else 
        disc_i=disc;
 
-    for(int i=1; i<=disc_i; i++)
-    {
-
-      interval ti = interval(i-1, i)/disc_i;
-
-      for(int j=1; j<=disc_j; j++)
-      {
-        interval tj = interval(j-1, j)/disc_j;
+    cellCount = disc_i*disc_j;
+    cellTotal += cellCount;
 
-        IVector Set_ij( dim ); // the centered part of the set with expanded directions
-        Set_ij.clear();        
+    std::vector<IVector> cellResults( disc_i*disc_j );      // cell (i,j) is stored at (i-1)*disc_j + (j-1)
+    int workerCount( threads < disc_i*disc_j ? threads : disc_i*disc_j );
 
-        if( !dir )
-        {
-          Set_ij[0] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of ys coordinate
-          Set_ij[2] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of v coordinate
-        }
-        else
-        {
-          Set_ij[2] = ( theSet[0].rightBound() - theSet[0].leftBound() )*ti + theSet[0].leftBound();    // subdivision of v coordinate
-          Set_ij[1] = ( theSet[1].rightBound() - theSet[1].leftBound() )*tj + theSet[1].leftBound();    // subdivision of yu coordinate
-        }
+    if( workerCount <= 1 )
+    {
+      for( int k = 0; k < disc_i*disc_j; k++ )
+        cellResults[k] = midCellImage( serialPM, theSet, dir, interval(k/disc_j, k/disc_j + 1)/disc_i, interval(k%disc_j, k%disc_j + 1)/disc_j );
+    }
+    else
+    {
+      ensureWorkers( pool, workerCount, ( !dir ? vectorField : vectorFieldRev ), midSection );
 
- /*       if( dim > 3 )  // checks whether we have parameters
-          for( int k=3; k < dim; k++ )
-            Set_ij[k] = params[k-3];      // we embed parameters  DEPRECATED
-*/
-        C0Rect2Set *setAff;
+      parallelFor( disc_i*disc_j, workerCount, [&]( int w, int k )
+      {
+        cellResults[k] = midCellImage( pool[w]->pm, theSet, dir, interval(k/disc_j, k/disc_j + 1)/disc_i, interval(k%disc_j, k%disc_j + 1)/disc_j );
+      } );
+    }
 
-        if( !dir )
-          setAff = new C0Rect2Set( section1CenterVector, P1, Set_ij ); // the set moved to default space, observe that parameters remain unchanged
-        else
-          setAff = new C0Rect2Set( section2CenterVector, P2, Set_ij );
-
-        interval returntime(0.);
-        IVector result = (*midPM)( *setAff, midCenterVector, inverseMatrix(midP), returntime );     // result is moved back to local coordinates, yu should be close to 0 
-                                                                                            // in other words midP^-1( PM(setAff) - midCenterVector ) is computed 
-                                                                                            // WARNING! THIS ZEROES PARAMETERS SO AS SUCH RESULT SHOULD NOT BE USED,
-                                                                                            // ONLY FIRST 3 COORDINATES OF IT (RETURNED BY THIS FUNCTION) CAN BE USED
-        delete setAff;
-      //  if( !dir )
-      //  {
-          if( i==1 && j==1)
-          {
-            resultArr[0] = result[0];   // midSection coordinates are given by midP - matrix P1 evolved by var. equation so similarly to P1 we project to ys, v coords, v "unstable"
-            resultArr[1] = result[2];  
-          }
-          else
-          {
-            resultArr[0] = intervalHull(resultArr[0], result[0]);
-            resultArr[1] = intervalHull(resultArr[1], result[2]);
-          }
-      /*  }
-        else
-        {
-          if( i==1 && j==1)
-          {
-            resultArr[0] = result[2];   // midSection coordinates are given by midP - matrix P1 evolved by var. equation so similarly to P1 we project to ys, v coords, v "unstable"
-            resultArr[1] = result[0];  
-          }
-          else
-          {
-            resultArr[0] = intervalHull(resultArr[0], result[2]);
-            resultArr[1] = intervalHull(resultArr[1], result[0]);
-          }
-        }*/
+    for( int k = 0; k < disc_i*disc_j; k++ )   // hull in the order of the cells as in operator()
+    {
+      if( k == 0 )
+        resultArr = cellResults[k];
+      else
+      {
+        resultArr[0] = intervalHull(resultArr[0], cellResults[k][0]);
+        resultArr[1] = intervalHull(resultArr[1], cellResults[k][1]);
       }
     }
-    delete midPM;
-    delete midSolver; 
     return resultArr;
   }
 
@@ -455,16 +678,19 @@ public:
   bool checkCovering( const IVector& Set1, const IVector& Set2 )  // both Set1 and Set2 are 2-dim and have first variable stable second unstable ( Set1 : ys, v; Set2 : v, yu )
   {
     IVector PSet1( integrateToMidSection( Set1, 0 ) );
-    IVector PSetUL1( integrateToMidSection( leftU(Set1), 0 ) );
-    IVector PSetUR1( integrateToMidSection( rightU(Set1), 0 ) );
+    CoveringGoal below1 = { 1, -1 }, above1 = { 1, 1 }, below0 = { 0, -1 }, above0 = { 0, 1 };   // the conditions on the edges checked below
+    IVector PSetUL1( integrateToMidSection( leftU(Set1), 0, below1 ) );
+    IVector PSetUR1( integrateToMidSection( rightU(Set1), 0, above1 ) );
 
-    cout << PSet1 << " -- " << PSetUL1 << " -- " << PSetUR1 << "\n";
+    if( log )
+      *log << PSet1 << " -- " << PSetUL1 << " -- " << PSetUR1 << "\n";
 
     IVector PSet2( integrateToMidSection( Set2 , 1 ) );
-    IVector PSetSL2( integrateToMidSection( leftS(Set2), 1 ) );
-    IVector PSetSR2( integrateToMidSection( rightS(Set2), 1 ) );
+    IVector PSetSL2( integrateToMidSection( leftS(Set2), 1, below0 ) );
+    IVector PSetSR2( integrateToMidSection( rightS(Set2), 1, above0 ) );
  
-    cout << PSet2 << " -- " << PSetSL2 << " -- " << PSetSR2 << "\n";
+    if( log )
+      *log << PSet2 << " -- " << PSetSL2 << " -- " << PSetSR2 << "\n";
  
     if( !( PSetUL1[1] + EPS < 0. && PSetUR1[1] - EPS > 0. && PSetSL2[0] + EPS < 0. && PSetSR2[0] - EPS > 0. ) )  // some reality checks for hyperbolicity
      throw "INTEGRATION TO MIDSECTION ERROR 1! \n";
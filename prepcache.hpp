@@ -0,0 +1,173 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing a persistent cache of the nonrigorous preprocessing
+ * of the proof: corrected corner points (including the v values of heteroclinics) and the coordinate
+ * changes at them. These only depend on the parameters, so repeated runs and restarted sweeps can
+ * read them from a file instead of shooting and computing eigenvectors again. Since they are
+ * nonrigorous anyway, a stale or foreign cache can make a proof fail, but never make it wrong.
+ * The file is a header (magic, version, record size) followed by fixed size records of doubles,
+ * it is memory-mapped when opened and new records are appended once a verification with them
+ * succeeds (see FhnVerifyExistenceOfPeriodicOrbit), so corner points corrected to a wrong branch are never kept.
+ * Several processes should not append to the same file at the same time.
+ * ----------------------------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- PREPROCESSING CACHE ----------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+class FhnPreprocessingCache
+{
+public:
+  static const unsigned int version = 1;   // increase whenever the preprocessing or the record layout changes, files of other versions are discarded
+
+  struct Header
+  {
+    char magic[8];
+    unsigned int version;
+    unsigned int recordSize;
+  };
+
+  struct Record              // coordinate changes depend on eps through the Jacobian at the corner points, so the key contains both parameter boxes
+  {
+    double theta[2];         // key: bounds of theta and eps
+    double eps[2];
+    double Gamma[4][3];      // GammaUL, GammaDL, GammaUR, GammaDR
+    double P[4][3][3];       // PUL, PUR, PDL, PDR
+  };
+
+  typedef std::tuple<double, double, double, double> Key;
+
+  std::string path;
+  void* mapping;             // the file as it was when opened
+  size_t mappingSize;
+  size_t validSize;          // size of the header and the complete records in the file
+  std::map<Key, const Record*> records;   // records of the mapping and those added since
+  std::deque<Record> added;  // a deque does not move its elements, so pointers to them stay valid
+  std::FILE* output;         // opened with the first store
+  std::mutex mutex;
+
+  FhnPreprocessingCache( const std::string& _path ) : path( _path ), mapping( 0 ), mappingSize( 0 ), validSize( 0 ), output( 0 )
+  {
+    int fd( ::open( path.c_str(), O_RDONLY ) );
+    if( fd < 0 )
+      return;                // no cache yet
+
+    struct stat info;
+    if( ::fstat( fd, &info ) == 0 && info.st_size >= (off_t)sizeof(Header) )
+    {
+      mappingSize = info.st_size;
+      mapping = ::mmap( 0, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if( mapping == MAP_FAILED )
+        mapping = 0;
+    }
+    ::close( fd );
+
+    if( !mapping )
+      return;
+
+    const Header* header( static_cast<const Header*>( mapping ) );
+    if( std::memcmp( header->magic, "FHNPREP", 8 ) != 0 || header->version != version || header->recordSize != sizeof(Record) )
+      return;                // validSize stays 0, the file is rewritten with the first store
+
+    size_t count( ( mappingSize - sizeof(Header) )/sizeof(Record) );    // an incomplete last record (e.g. of an interrupted run) is ignored and overwritten
+    validSize = sizeof(Header) + count*sizeof(Record);
+
+    const Record* first( reinterpret_cast<const Record*>( static_cast<const char*>( mapping ) + sizeof(Header) ) );
+    for( size_t k = 0; k < count; k++ )
+      records[ key( first[k].theta, first[k].eps ) ] = first + k;
+  }
+
+  ~FhnPreprocessingCache()
+  {
+    if( output )
+      std::fclose( output );
+    if( mapping )
+      ::munmap( mapping, mappingSize );
+  }
+
+  static Key key( const double theta[2], const double eps[2] )
+  {
+    return Key( theta[0], theta[1], eps[0], eps[1] );
+  }
+
+  bool load( const interval& _theta, const interval& _eps, IVector* Gamma[4], IMatrix* P[4] ) // Gammas UL, DL, UR, DR and matrices PUL, PUR, PDL, PDR, returns 0 if not cached
+  {
+    double theta[2] = { _theta.leftBound(), _theta.rightBound() }, eps[2] = { _eps.leftBound(), _eps.rightBound() };
+
+    std::lock_guard<std::mutex> lock( mutex );
+    std::map<Key, const Record*>::iterator found( records.find( key( theta, eps ) ) );
+    if( found == records.end() )
+      return 0;
+
+    const Record& record( *found->second );
+    for( int c = 0; c < 4; c++ )
+    {
+      *Gamma[c] = IVector( 3 );
+      *P[c] = IMatrix( 3, 3 );
+      for( int i = 0; i < 3; i++ )
+      {
+        (*Gamma[c])[i] = record.Gamma[c][i];
+        for( int j = 0; j < 3; j++ )
+          (*P[c])[i][j] = record.P[c][i][j];
+      }
+    }
+    return 1;
+  }
+
+  void store( const interval& _theta, const interval& _eps, IVector* Gamma[4], IMatrix* P[4] ) // the same order as in load, all entries are points (doubles)
+  {
+    Record record;
+    record.theta[0] = _theta.leftBound();
+    record.theta[1] = _theta.rightBound();
+    record.eps[0] = _eps.leftBound();
+    record.eps[1] = _eps.rightBound();
+    for( int c = 0; c < 4; c++ )
+      for( int i = 0; i < 3; i++ )
+      {
+        record.Gamma[c][i] = (*Gamma[c])[i].leftBound();
+        for( int j = 0; j < 3; j++ )
+          record.P[c][i][j] = (*P[c])[i][j].leftBound();
+      }
+
+    std::lock_guard<std::mutex> lock( mutex );
+    added.push_back( record );
+    records[ key( record.theta, record.eps ) ] = &added.back();
+
+    if( !output && !openOutput() )
+      return;                // the cache still works in memory
+    std::fwrite( &record, sizeof(Record), 1, output );
+    std::fflush( output );   // records of an interrupted sweep are kept
+  }
+
+  bool openOutput()          // appends to the valid part of the file, or starts a new file
+  {
+    if( validSize > 0 )
+    {
+      if( ::truncate( path.c_str(), validSize ) != 0 )
+        return 0;
+      output = std::fopen( path.c_str(), "ab" );
+      return output != 0;
+    }
+
+    output = std::fopen( path.c_str(), "wb" );
+    if( !output )
+      return 0;
+    Header header;
+    std::memcpy( header.magic, "FHNPREP", 8 );
+    header.version = version;
+    header.recordSize = sizeof(Record);
+    std::fwrite( &header, sizeof(Header), 1, output );
+    return 1;
+  }
+};
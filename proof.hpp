@@ -5,33 +5,148 @@
  * in the FitzHugh-Nagumo system for given parameters theta, eps. 
  * * ----------------------------------------------------------------------------------------*/
 
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- CORNER POINTS ----------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+bool FhnCornersOrdered( const IVector& GammaUL, const IVector& GammaDL, const IVector& GammaUR, const IVector& GammaDR ) // whether the corner points are up/down to the left/right
+                                                                                                                       // of each other, i.e. on the right branches
+{
+  return GammaUL[0] > GammaDL[0] && GammaUR[0] > GammaDR[0] && GammaUR[2] > GammaUL[2] && GammaDR[2] > GammaDL[2];
+}
+
+int FhnCornerPoints( const interval& _theta, IVector& GammaUL, IVector& GammaDL, IVector& GammaUR, IVector& GammaDR, FhnCornerCache* _cache = 0 )
+  // with _cache the initial guesses are predicted from corner points of nearby theta values (if there are any), the corrected ones are only remembered
+  // once the verification with them succeeds (see FhnVerifyExistenceOfPeriodicOrbit); returns the number of shooting evaluations of the successful correction (see GammaQuad_correct)
+{
+  double theta( _theta.leftBound() );
+  DVector predicted( 6 );
+
+  if( _cache && _cache->predict( theta, predicted ) )
+  {
+    GammaUL = IVector( predicted[0], 0., predicted[4] );
+    GammaDL = IVector( predicted[1], 0., predicted[4] );
+    GammaUR = IVector( predicted[2], 0., predicted[5] );
+    GammaDR = IVector( predicted[3], 0., predicted[5] );
+
+    try
+    {
+      int evaluations( GammaQuad_correct( _theta, GammaUL, GammaDL, GammaUR, GammaDR ) );
+      if( FhnCornersOrdered( GammaUL, GammaDL, GammaUR, GammaDR ) )
+        return evaluations;
+    }
+    catch(const char*)     // the prediction was too poor
+    {
+    }
+    // the correction failed or converged to a wrong branch, we start over from the original guesses
+  }
+
+  GammaUL = IVector(0.970345591417269, 0., 0.0250442158334208);                                   // some guesses for the corner points which are equilibria
+  GammaDL = IVector(-0.108412947498862, 0., 0.0250442158334208);                                  // of the fast subsystem for critical parameter v values (third variable)
+                                                                                                  // where heteroclinics exist
+  GammaUR = IVector(0.841746280832201, 0., 0.0988076360184288);                                   // UR up right, DR down right, UL up left, DL down left
+  GammaDR = IVector(-0.237012258083933, 0., 0.0988076360184288);
+
+  int evaluations( GammaQuad_correct( _theta, GammaUL, GammaDL, GammaUR, GammaDR ) );   // we correct the initial guesses by nonrigorous Newtons methods (see numerics.hpp)
+  if( !FhnCornersOrdered( GammaUL, GammaDL, GammaUR, GammaDR ) )
+    throw "NEWTON CORRECTION METHOD FOR CORNER POINTS ERROR! \n";
+  return evaluations;
+}
+
 /* ------------------------------------------------------------------------------------ */
 /* ----- VERIFICATION OF EXISTENCE OF PERIODIC ORBITS FOR GIVEN PARAMETER VALUES ------ */
 /* ------------------------------------------------------------------------------------ */
 
+struct FhnVerificationResult
+{
+  bool verified;
+  std::string failedCheck;        // message of the check which failed, empty if verified
+  std::string failedLocation;     // the first face box without the required sign if an isolation check failed (not in verbose mode, which evaluates whole faces)
+  double wallTime;                // in seconds
+  std::string report;             // JSON report of the instrumentation (see instrument.hpp), empty if it was not requested
+  bool midsectionCovering;        // result of the midsection test map, which does not take part in the proof
+};
 
-void FhnVerifyExistenceOfPeriodicOrbit( interval _theta, interval _eps, bool _verbose = 0, bool withParams = 0, int _pMapDivCount = 20, 
-     int _longSubsegmentCount = 100, int _longSegmentDivCount = 80, int _cornerSegmentDivCount = 200 ) 
+struct FhnProofSettings           // options of FhnVerifyExistenceOfPeriodicOrbit other than the discretization, the defaults are those of the original proof
+{
+  int threadCount;                // number of threads used for the parallelized parts (0 - all available)
+  int pMapCellBudget;             // maximal number of cells of the adaptive subdivision of sets to integrate which starts from the _pMapDivCount grid 
+                                  // (0 - uniform grid, no adaptive subdivision)
+  double pMapCellTolerance;       // the width up to which the adaptive subdivision refines cells of whole sets to integrate (edges are refined until
+                                  // their images satisfy the covering conditions, 0 - whole sets are not refined)
+  int faceRefineDepth;            // number of bisections of face boxes whose products are not yet of the required sign, starting from correspondingly coarser grids (0 - uniform grids)
+  FhnCornerCache* cornerCache;    // corner points of nearby theta values to start their corrections from, the corner points are added to it 
+                                  // if the verification succeeds (0 - always start from the original guesses)
+  FhnPreprocessingCache* preprocessingCache;   // persistent cache of corner points and coordinate changes, which are then only computed if they are not cached yet,
+                                               // they are added to it if the verification succeeds (0 - no cache)
+  FhnCheckpoint* checkpoint;      // checkpoints of finished stages (see checkpoint.hpp), which are then skipped by a restarted verification with the same inputs (0 - no checkpoints)
+  FhnCertificateWriter* certificate;   // certificate to which all checked enclosures are written (see certificate.hpp, 0 - none)
+  bool instrument;                // whether to count the work of the stages and time them (see instrument.hpp), the JSON report is returned in the result also if the verification fails
+  bool quiet;                     // whether to write nothing to cout (e.g. when several verifications run concurrently), the outcome is then only in the result
+
+  FhnProofSettings()
+    : threadCount( 1 ),
+      pMapCellBudget( 0 ),
+      pMapCellTolerance( 0. ),
+      faceRefineDepth( 0 ),
+      cornerCache( 0 ),
+      preprocessingCache( 0 ),
+      checkpoint( 0 ),
+      certificate( 0 ),
+      instrument( 0 ),
+      quiet( 0 )
+  {
+  }
+};
+
+FhnVerificationResult FhnVerifyExistenceOfPeriodicOrbit( interval _theta, interval _eps, bool _verbose = 0, bool withParams = 0, int _pMapDivCount = 20, 
+     int _longSubsegmentCount = 100, int _longSegmentDivCount = 80, int _cornerSegmentDivCount = 200, const FhnProofSettings& _settings = FhnProofSettings() ) 
   // verbose on displays all the interval enclosures for Poincare maps / products of vector fields with normals; other parameters control respectively: 
   // number of subdivisions of sets to integrate (in each dimension), number of subsegments along slow manifolds, number of subdivisions of regular/corner segments
-  // for evaluation of the scalar product of vector field with outward pointing normals
+  // for evaluation of the scalar product of vector field with outward pointing normals, and the remaining options (see FhnProofSettings);
+  // the global vector fields are only copied, so that verifications for different parameters can run concurrently
 {
+  FhnVerificationResult result = { 0, "", "", 0., "", 0 };
+  std::ostream discard( 0 );      // without a stream buffer, everything written to it is dropped
+  std::ostream& out( _settings.quiet ? discard : cout );
+  std::map<std::string, std::string> violationLocations;   // failed isolation check -> first face box without the required sign
+  std::mutex violationMutex;
+  std::chrono::steady_clock::time_point start( std::chrono::steady_clock::now() );
+  std::unique_ptr<FhnInstrumentation> instrumentation( _settings.instrument ? new FhnInstrumentation() : 0 );
+  FhnInstrumentation* stats( instrumentation.get() );     // null if not instrumented
+  uint32_t run( _settings.certificate ? _settings.certificate->beginRun( _theta, _eps ) : 0 );   // number of this verification in the certificate
+
   try                   // we check negations of all assumptions to throw exceptions, if no exception is thrown existence of the orbit is verified
   {
-    Fhn_vf.setParameter("theta",_theta);
-    Fhn_vf.setParameter("eps",_eps);
+    IMap vectorField( Fhn_vf );
+    vectorField.setParameter("theta",_theta);
+    vectorField.setParameter("eps",_eps);
+
+    if( !FhnVectorFieldSelfTest( vectorField, 100 ) )    // face products of all segments are evaluated by the hand-written vector field (see also kernelSelfTest)
+      throw "SELF-TEST OF THE HAND-WRITTEN VECTOR FIELD FAILED! \n";
 
     IVector parameters({ _theta, _eps });
 
-    IVector GammaUL(0.970345591417269, 0., 0.0250442158334208);                                   // some guesses for the corner points which are equilibria
-    IVector GammaDL(-0.108412947498862, 0., 0.0250442158334208);                                  // of the fast subsystem for critical parameter v values (third variable)
-                                                                                                  // where heteroclinics exist
-    IVector GammaUR(0.841746280832201, 0., 0.0988076360184288);                                   // UR up right, DR down right, UL up left, DL down left
-    IVector GammaDR(-0.237012258083933, 0., 0.0988076360184288);
+    IVector GammaUL(3), GammaDL(3), GammaUR(3), GammaDR(3);
+    IMatrix PUL(3,3), PUR(3,3), PDL(3,3), PDR(3,3);
+
+    IVector* Gammas[4] = { &GammaUL, &GammaDL, &GammaUR, &GammaDR };
+    IMatrix* Ps[4] = { &PUL, &PUR, &PDL, &PDR };
+
+    bool preprocessed( !( _settings.preprocessingCache && _settings.preprocessingCache->load( _theta, _eps, Gammas, Ps ) ) );   // not taken from the cache
+    if( preprocessed )
+    {
+      FhnStageTimer timer( stats, "corner points and coordinate changes" );
 
-    GammaQuad_correct( _theta, GammaUL, GammaDL, GammaUR, GammaDR );                              // we correct the initial guesses by nonrigorous Newtons methods (see numerics.hpp)
+      FhnCount( stats, FhnInstrumentation::SHOOTING_EVALUATIONS, FhnCornerPoints( _theta, GammaUL, GammaDL, GammaUR, GammaDR, _settings.cornerCache ) );
 
-    if( !(GammaUL[0] > GammaDL[0] && GammaUR[0] > GammaDR[0] && GammaUR[2] > GammaUL[2] && GammaDR[2] > GammaDL[2] ) )
+      PUL = coordChange( vectorField, GammaUL );
+      PUR = coordChange( vectorField, GammaUR );
+      PDL = coordChange( vectorField, GammaDL );
+      PDR = coordChange( vectorField, GammaDR );
+    }
+
+    if( !FhnCornersOrdered( GammaUL, GammaDL, GammaUR, GammaDR ) )      // also corner points taken from the preprocessing cache
       throw "NEWTON CORRECTION METHOD FOR CORNER POINTS ERROR! \n";
         
     interval ruDL(0.011);           // distances from appropriate sections in appropr. direction (stable for sections to integrate from, unstable for sections to integrate onto)
@@ -40,28 +155,40 @@ void FhnVerifyExistenceOfPeriodicOrbit( interval _theta, interval _eps, bool _ve
     interval ruUR(0.0015);
     interval rsDR(0.028);
 
-    IMatrix PUL( coordChange( Fhn_vf, GammaUL ) ), 
-            PUR( coordChange( Fhn_vf, GammaUR ) ), 
-            PDL( coordChange( Fhn_vf, GammaDL ) ),  
-            PDR( coordChange( Fhn_vf, GammaDR ) ); 
-
-    FhnPoincareMap *PMAPL;
-    FhnPoincareMap *PMAPR;
-    
-    midPoincareMap testMap( parameters, Fhn_vf_withParams, Fhn_vf_withParams_rev, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., 60 );
+    std::unique_ptr<FhnPoincareMap> PMAPL;
+    std::unique_ptr<FhnPoincareMap> PMAPR;
     
 
+    int threads( threadCount( _settings.threadCount ) );
+    int mapThreads( threads > 3 ? ( threads - 2 )/2 : 1 );   // the two Poincare maps run concurrently, and with them the (serial) DL and UR segments,
+    int upThreads( threads > 1 ? ( threads + 1 )/2 : 1 );    // so do the two long segments, they share the threads
+    int downThreads( threads > 1 ? threads/2 : 1 );
+
+    bool stopOnWrongSign( !_verbose );     // unless all enclosures are to be displayed, face sweeps stop at the first box without the required sign
+
+    auto checkViolation = [&]( const FhnIsolatingSegment& segment, const char* message )   // segments are verified concurrently, so the location is stored by the message
+    {
+      if( segment.violation.face >= 0 )
+      {
+        std::lock_guard<std::mutex> lock( violationMutex );
+        violationLocations[message] = segment.violation.location();
+        throw message;
+      }
+    };
 
     if( withParams )
     {
-      PMAPL = new FhnPoincareMap( Fhn_vf, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., _pMapDivCount ); // -1 because the exit/entrance sections are aligned in a reversed order
-      PMAPR = new FhnPoincareMap( Fhn_vf, PUR, PDR, GammaUR, GammaDR, ruUR, rsDR, 1., _pMapDivCount );
+      PMAPL.reset( new FhnPoincareMap( vectorField, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., _pMapDivCount, mapThreads ) ); // -1 because the exit/entrance sections are aligned in a reversed order
+      PMAPR.reset( new FhnPoincareMap( vectorField, PUR, PDR, GammaUR, GammaDR, ruUR, rsDR, 1., _pMapDivCount, mapThreads ) );
     }
     else
     {
-      PMAPL = new FhnPoincareMap( parameters, Fhn_vf_withParams, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., _pMapDivCount ); 
-      PMAPR = new FhnPoincareMap( parameters, Fhn_vf_withParams, PUR, PDR, GammaUR, GammaDR, ruUR, rsDR, 1., _pMapDivCount );
+      PMAPL.reset( new FhnPoincareMap( parameters, Fhn_vf_withParams, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., _pMapDivCount, mapThreads ) ); 
+      PMAPR.reset( new FhnPoincareMap( parameters, Fhn_vf_withParams, PUR, PDR, GammaUR, GammaDR, ruUR, rsDR, 1., _pMapDivCount, mapThreads ) );
     } 
+    PMAPL->cellBudget = PMAPR->cellBudget = _settings.pMapCellBudget;
+    PMAPL->cellTolerance = PMAPR->cellTolerance = _settings.pMapCellTolerance;
+    CoveringGoal leftEdgeGoal = { 1, -1 }, rightEdgeGoal = { 1, 1 };   // the covering conditions on the images of the unstable edges checked below
 
     IVector setToIntegrateDL(2);
     IVector setToIntegrateUR(2);
@@ -83,176 +210,454 @@ void FhnVerifyExistenceOfPeriodicOrbit( interval _theta, interval _eps, bool _ve
     setToBackIntegrateDR[0] = 1.0e-3*interval(-1,1);      
     setToBackIntegrateDR[1] = 1.0e-4*interval(-1,1);     
 
-    // left corner segments/coverings
-  
-    cout << testMap.checkCovering( setToIntegrateDL, setToBackIntegrateUL ) << "! \n";
+    {
+      FhnStageTimer timer( stats, "midsection test map" );
+
+      FhnCheckpoint::Hash testMapKey( "midsection test map" );
+      testMapKey.add( _theta ).add( _eps ).addMatrix( PDL ).addMatrix( PUL ).addVector( GammaDL ).addVector( GammaUL ).add( ruDL ).add( rsUL );
+      testMapKey.addVector( setToIntegrateDL ).addVector( setToBackIntegrateUL );
+      std::vector<double> testMapCovering;
+
+      if( !( _settings.checkpoint && _settings.checkpoint->load( testMapKey, testMapCovering ) ) )
+      {
+        midPoincareMap testMap( parameters, Fhn_vf_withParams, Fhn_vf_withParams_rev, PDL, PUL, GammaDL, GammaUL, ruDL, rsUL, -1., 60, 1, _settings.quiet ? 0 : &cout );
+        testMapCovering.assign( 1, testMap.checkCovering( setToIntegrateDL, setToBackIntegrateUL ) );
+        FhnCount( stats, FhnInstrumentation::POINCARE_MAP_CALLS, testMap.cellTotal );
+        if( _settings.checkpoint && testMapCovering[0] )    // only passed checks are stored, a failed covering is tried again
+          _settings.checkpoint->store( testMapKey, testMapCovering );
+      }
+      result.midsectionCovering = testMapCovering[0];
+      out << result.midsectionCovering << "! \n";
+    }
 
-    IVector PMAPL_leftU = (*PMAPL)( leftU(setToIntegrateDL) );
-    IVector PMAPL_rightU = (*PMAPL)( rightU(setToIntegrateDL) );
-    IVector PMAPL_all = (*PMAPL)( setToIntegrateDL );
+    auto poincareMapKey = [&]( const char* stage, const FhnPoincareMap& map, const IVector& set ) -> FhnCheckpoint::Hash   // everything the images of set depend on
+    {
+      FhnCheckpoint::Hash key( stage );
+      key.add( _theta ).add( _eps ).add( int( withParams ) ).addMatrix( map.P1 ).addMatrix( map.P2 ).addVector( map.GammaU1 ).addVector( map.GammaU2 );
+      key.addVector( map.section1CenterVector ).addVector( map.section2CenterVector ).add( map.disc ).add( map.cellBudget ).add( map.cellTolerance );
+      return key.addVector( set );
+    };
 
-    delete PMAPL;
+    // the rest of the proof is a graph of tasks, each with its inputs and outputs listed, independent ones run concurrently;
+    // verbose output of each task is collected in its report and displayed in the order of tasks once the graph has finished
 
-    if( _verbose )
-    {
-      cout << "\n ----------------------------- LEFT POINCARE MAP: --------------------------------- \n \n";
+    TaskGraph graph;
+    std::ostringstream reportPMAPL, reportPMAPR, reportLeftSegments, reportRightSegments, reportLongSegments;
+    std::ostringstream* reports[5] = { &reportPMAPL, &reportLeftSegments, &reportPMAPR, &reportRightSegments, &reportLongSegments };
+    for( int k = 0; k < 5; k++ )
+      reports[k]->precision( cout.precision() );
 
-      cout << "All enclosures in section coordinates! \n" << "Image enclosure of DL segment exit face through left Poincare map: \n \n" << PMAPL_all << "\n \n" 
-        << "Image enclosure of left unstable edge of DL segment exit face through left Poincare map: \n \n" << PMAPL_leftU << "\n \n" << 
-        "Image enclosure of right unstable edge of DL segment exit face through left Poincare map: \n \n" << PMAPL_rightU << "\n \n";
-    }
+    IVector PMAPL_leftU, PMAPL_rightU, PMAPL_all;
+    IVector PMAPR_leftU, PMAPR_rightU, PMAPR_all;
 
-   
-    if( !( PMAPL_leftU[1] + EPS < 0. && PMAPL_rightU[1] - EPS > 0. && PMAPL_all[0].leftBound() < 0. && PMAPL_all[0].rightBound() > 0. ) )
-      throw "LEFT POINCARE MAP COVERING ERROR! \n";
+    IVector ULface, DLface, URface, DRface;
+    std::unique_ptr<FhnIsolatingSegment> ULSegment, DLSegment, URSegment, DRSegment;
+    std::unique_ptr<longIsolatingSegment> UpSegment, DownSegment;
+
+    // left corner segments/coverings
+
+    int leftMapTask = graph.add( "left Poincare map", {}, [&]()    // in: PMAPL, setToIntegrateDL; out: PMAPL_leftU, PMAPL_rightU, PMAPL_all
+    {
+      FhnStageTimer timer( stats, "left Poincare map" );
+
+      FhnCheckpoint::Hash PMAPLKey( poincareMapKey( "left Poincare map", *PMAPL, setToIntegrateDL ) );
+      std::vector<double> PMAPLImages;
+      bool PMAPLResumed( _settings.checkpoint && _settings.checkpoint->load( PMAPLKey, PMAPLImages ) );
+      int PMAPL_leftUCells( 0 ), PMAPL_rightUCells( 0 ), PMAPL_allCells( 0 );   // images taken from the checkpoint integrate no cells
+
+      if( PMAPLResumed )
+      {
+        size_t position( 0 );
+        PMAPL_leftU = FhnCheckpoint::extract( PMAPLImages, position );
+        PMAPL_rightU = FhnCheckpoint::extract( PMAPLImages, position );
+        PMAPL_all = FhnCheckpoint::extract( PMAPLImages, position );
+      }
+      else
+      {
+        PMAPL_leftU = (*PMAPL)( leftU(setToIntegrateDL), leftEdgeGoal );
+        PMAPL_leftUCells = PMAPL->cellCount;
+        PMAPL_rightU = (*PMAPL)( rightU(setToIntegrateDL), rightEdgeGoal );
+        PMAPL_rightUCells = PMAPL->cellCount;
+        PMAPL_all = (*PMAPL)( setToIntegrateDL );
+        PMAPL_allCells = PMAPL->cellCount;
+        FhnCount( stats, FhnInstrumentation::POINCARE_MAP_CALLS, PMAPL->cellTotal );
+      }
+
+      PMAPL.reset();
+
+      FhnCertificateStream PMAPLCertificate( _settings.certificate, run, FhnCertificateRecord::LEFT_POINCARE_MAP );
+      if( _settings.certificate )
+      {
+        PMAPLCertificate.image( 0, PMAPL_leftU );
+        PMAPLCertificate.image( 1, PMAPL_rightU );
+        PMAPLCertificate.image( 2, PMAPL_all );
+      }
+
+      if( _verbose )
+      {
+        reportPMAPL << "\n ----------------------------- LEFT POINCARE MAP: --------------------------------- \n \n";
+
+        reportPMAPL << "All enclosures in section coordinates! \n" << "Image enclosure of DL segment exit face through left Poincare map: \n \n" << PMAPL_all << "\n \n" 
+          << "Image enclosure of left unstable edge of DL segment exit face through left Poincare map: \n \n" << PMAPL_leftU << "\n \n" << 
+          "Image enclosure of right unstable edge of DL segment exit face through left Poincare map: \n \n" << PMAPL_rightU << "\n \n";
+        reportPMAPL << "Number of cells integrated (face, left edge, right edge): " << PMAPL_allCells << ", " << PMAPL_leftUCells << ", " << PMAPL_rightUCells << "\n \n";
+      }
+
+      if( !( PMAPL_leftU[1] + EPS < 0. && PMAPL_rightU[1] - EPS > 0. && PMAPL_all[0].leftBound() < 0. && PMAPL_all[0].rightBound() > 0. ) )
+        throw "LEFT POINCARE MAP COVERING ERROR! \n";
+
+      if( _settings.checkpoint && !PMAPLResumed )
+      {
+        FhnCheckpoint::append( PMAPLImages, PMAPL_leftU );
+        FhnCheckpoint::append( PMAPLImages, PMAPL_rightU );
+        FhnCheckpoint::append( PMAPLImages, PMAPL_all );
+        _settings.checkpoint->store( PMAPLKey, PMAPLImages );
+      }
+    } );
 
     // faces of two isolating segments around slow manifolds - determined by the stable/unstable distances from slow manifolds given above, used also in rigorous integration
     // unstable faces are shortened by a small number EPS - so that there is covering by image of Poincare map
     // zeroes at the third coordinate are just to make some algebra easier (adding to 3d vectors etc.)
 
-    IVector ULface( rsUL*interval(-1,1), interval( (PMAPL_leftU[1] + EPS).rightBound(), (PMAPL_rightU[1] - EPS).leftBound() ), 0. ); 
-    IVector DLface( setToIntegrateDL[0], ruDL*interval(-1,1), 0. ); 
+    int ULSegmentTask = graph.add( "UL segment", { leftMapTask }, [&]()   // in: PMAPL_leftU, PMAPL_rightU, PMAPL_all; out: ULface, ULSegment
+    {
+      FhnStageTimer timer( stats, "UL segment" );
 
-    FhnIsolatingSegment ULSegment( Fhn_vf, GammaUL + IVector( 0., 0., PMAPL_all[0].leftBound()-EPS ), 
-        GammaUL + IVector( 0., 0., PMAPL_all[0].rightBound()+EPS ), PUL, ULface, ULface, _cornerSegmentDivCount ); // v face is expanded by EPS to get stable face covering from Poincare map
-    FhnIsolatingSegment DLSegment( Fhn_vf, GammaDL + IVector( 0., 0., setToIntegrateDL[1].leftBound() ), 
-      GammaDL + IVector( 0., 0., setToIntegrateDL[1].rightBound() ), PDL, DLface, DLface, _cornerSegmentDivCount );  // TODO: add EPS?
+      ULface = IVector( rsUL*interval(-1,1), interval( (PMAPL_leftU[1] + EPS).rightBound(), (PMAPL_rightU[1] - EPS).leftBound() ), 0. ); 
 
-    IVector ULSegment_entranceVerification( ULSegment.entranceVerification() );
-    IVector ULSegment_exitVerification( ULSegment.exitVerification() );
-    IVector DLSegment_entranceVerification( DLSegment.entranceVerification() );
-    IVector DLSegment_exitVerification( DLSegment.exitVerification() );
+      ULSegment.reset( new FhnIsolatingSegment( vectorField, GammaUL + IVector( 0., 0., PMAPL_all[0].leftBound()-EPS ), 
+          GammaUL + IVector( 0., 0., PMAPL_all[0].rightBound()+EPS ), PUL, ULface, ULface, _cornerSegmentDivCount ) ); // v face is expanded by EPS to get stable face covering from Poincare map
+      ULSegment->refineDepth = _settings.faceRefineDepth;
+      ULSegment->checkpoint = _settings.checkpoint;
+      ULSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::UL_SEGMENT );
 
-    if( _verbose )
-    {
-      cout << "\n ------------------- UL, DL SEGMENTS ISOLATION: -------------------------- \n \n";
+      FhnIsolatingSegment::FaceVerification ULSegment_faces( ULSegment->verifyAllFaces( stopOnWrongSign ) );      // all four faces of a segment in one pass
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, ULSegment->evaluationCount );
+      checkViolation( *ULSegment, "ISOLATION ERROR FOR UL CORNER SEGMENT! \n" );
 
-      cout << "Enclosures of scalar product of vector field with entrance faces normals for DL segment: \n \n" << DLSegment_entranceVerification << "\n";  
-      cout << "\n --- \n";
-      cout << "Enclosures of scalar product of vector field with exit faces normals for DL segment: \n \n" << DLSegment_exitVerification << "\n";
+      IVector ULSegment_entranceVerification( ULSegment_faces.entrance() );
+      IVector ULSegment_exitVerification( ULSegment_faces.exit() );
 
-      cout << "\n --- \n";
+      if( _verbose )
+      {
+        reportLeftSegments << "Enclosures of scalar product of vector field with entrance faces normals for UL segment: \n \n" << ULSegment_entranceVerification << "\n";  
+        reportLeftSegments << "\n --- \n";
+        reportLeftSegments << "Enclosures of scalar product of vector field with exit faces normals for UL segment: \n \n" << ULSegment_exitVerification << "\n";
+        reportLeftSegments << "\n --- \n";
+        reportLeftSegments << "Number of face products evaluated for UL segment: " << ULSegment->evaluationCount << "\n";
+        reportLeftSegments << "\n --- \n";
+      }
 
-      cout << "Enclosures of scalar product of vector field with entrance faces normals for UL segment: \n \n" << ULSegment_entranceVerification << "\n";  
-      cout << "\n --- \n";
-      cout << "Enclosures of scalar product of vector field with exit faces normals for UL segment: \n \n" << ULSegment_exitVerification << "\n";
+      if( !( ULSegment_entranceVerification[0] < 0. && ULSegment_entranceVerification[1] < 0. && ULSegment_exitVerification[0] > 0. && ULSegment_exitVerification[1] > 0. ) )
+        throw "ISOLATION ERROR FOR UL CORNER SEGMENT! \n";
+    } );
 
+    std::ostringstream reportDLSegment;   // DL runs concurrently with UL, its report is appended to reportLeftSegments afterwards
+    reportDLSegment.precision( cout.precision() );
 
-      cout << "\n --- \n";
-      cout << "\n --- \n";
-    };
+    int DLSegmentTask = graph.add( "DL segment", {}, [&]()   // in: setToIntegrateDL; out: DLface, DLSegment
+    {
+      FhnStageTimer timer( stats, "DL segment" );
+
+      DLface = IVector( setToIntegrateDL[0], ruDL*interval(-1,1), 0. ); 
+
+      DLSegment.reset( new FhnIsolatingSegment( vectorField, GammaDL + IVector( 0., 0., setToIntegrateDL[1].leftBound() ), 
+        GammaDL + IVector( 0., 0., setToIntegrateDL[1].rightBound() ), PDL, DLface, DLface, _cornerSegmentDivCount ) );  // TODO: add EPS?
+      DLSegment->refineDepth = _settings.faceRefineDepth;
+      DLSegment->checkpoint = _settings.checkpoint;
+      DLSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::DL_SEGMENT );
 
-    if( !( ULSegment_entranceVerification[0] < 0. && ULSegment_entranceVerification[1] < 0. && ULSegment_exitVerification[0] > 0. && ULSegment_exitVerification[1] > 0. ) )
-      throw "ISOLATION ERROR FOR UL CORNER SEGMENT! \n";
-    if( !( DLSegment_entranceVerification[0] < 0. && DLSegment_entranceVerification[1] < 0. && DLSegment_exitVerification[0] > 0. && DLSegment_exitVerification[1] > 0. ) )
-      throw "ISOLATION ERROR FOR DL CORNER SEGMENT! \n";
+      FhnIsolatingSegment::FaceVerification DLSegment_faces( DLSegment->verifyAllFaces( stopOnWrongSign ) );
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, DLSegment->evaluationCount );
+      checkViolation( *DLSegment, "ISOLATION ERROR FOR DL CORNER SEGMENT! \n" );
 
+      IVector DLSegment_entranceVerification( DLSegment_faces.entrance() );
+      IVector DLSegment_exitVerification( DLSegment_faces.exit() );
+
+      if( _verbose )
+      {
+        reportDLSegment << "Enclosures of scalar product of vector field with entrance faces normals for DL segment: \n \n" << DLSegment_entranceVerification << "\n";  
+        reportDLSegment << "\n --- \n";
+        reportDLSegment << "Enclosures of scalar product of vector field with exit faces normals for DL segment: \n \n" << DLSegment_exitVerification << "\n";
+        reportDLSegment << "\n --- \n";
+        reportDLSegment << "Number of face products evaluated for DL segment: " << DLSegment->evaluationCount << "\n";
+        reportDLSegment << "\n --- \n";
+      }
+
+      if( !( DLSegment_entranceVerification[0] < 0. && DLSegment_entranceVerification[1] < 0. && DLSegment_exitVerification[0] > 0. && DLSegment_exitVerification[1] > 0. ) )
+        throw "ISOLATION ERROR FOR DL CORNER SEGMENT! \n";
+    } );
 
     // right corner segments/coverings
 
-    IVector PMAPR_leftU = (*PMAPR)( leftU(setToIntegrateUR) );
-    IVector PMAPR_rightU = (*PMAPR)( rightU(setToIntegrateUR) );
-    IVector PMAPR_all = (*PMAPR)( setToIntegrateUR );
-    
-    delete PMAPR;
-  
-    if( _verbose )
+    int rightMapTask = graph.add( "right Poincare map", {}, [&]()    // in: PMAPR, setToIntegrateUR; out: PMAPR_leftU, PMAPR_rightU, PMAPR_all
     {
-      cout << "\n ----------------------------- RIGHT POINCARE MAP: --------------------------------- \n \n";
-
-      cout << "All enclosures in section coordinates! \n" << "Image enclosure of UR segment exit face through right Poincare map: \n \n" << PMAPR_all << "\n \n" 
-        << "Image enclosure of left unstable edge of UR segment exit face through right Poincare map: \n \n" << PMAPR_leftU << "\n \n" << 
-        "Image enclosure of right unstable edge of UR segment exit face through right Poincare map: \n \n" << PMAPR_rightU << "\n \n";
-    }
+      FhnStageTimer timer( stats, "right Poincare map" );
+
+      FhnCheckpoint::Hash PMAPRKey( poincareMapKey( "right Poincare map", *PMAPR, setToIntegrateUR ) );
+      std::vector<double> PMAPRImages;
+      bool PMAPRResumed( _settings.checkpoint && _settings.checkpoint->load( PMAPRKey, PMAPRImages ) );
+      int PMAPR_leftUCells( 0 ), PMAPR_rightUCells( 0 ), PMAPR_allCells( 0 );   // images taken from the checkpoint integrate no cells
+
+      if( PMAPRResumed )
+      {
+        size_t position( 0 );
+        PMAPR_leftU = FhnCheckpoint::extract( PMAPRImages, position );
+        PMAPR_rightU = FhnCheckpoint::extract( PMAPRImages, position );
+        PMAPR_all = FhnCheckpoint::extract( PMAPRImages, position );
+      }
+      else
+      {
+        PMAPR_leftU = (*PMAPR)( leftU(setToIntegrateUR), leftEdgeGoal );
+        PMAPR_leftUCells = PMAPR->cellCount;
+        PMAPR_rightU = (*PMAPR)( rightU(setToIntegrateUR), rightEdgeGoal );
+        PMAPR_rightUCells = PMAPR->cellCount;
+        PMAPR_all = (*PMAPR)( setToIntegrateUR );
+        PMAPR_allCells = PMAPR->cellCount;
+        FhnCount( stats, FhnInstrumentation::POINCARE_MAP_CALLS, PMAPR->cellTotal );
+      }
+      
+      PMAPR.reset();
+
+      FhnCertificateStream PMAPRCertificate( _settings.certificate, run, FhnCertificateRecord::RIGHT_POINCARE_MAP );
+      if( _settings.certificate )
+      {
+        PMAPRCertificate.image( 0, PMAPR_leftU );
+        PMAPRCertificate.image( 1, PMAPR_rightU );
+        PMAPRCertificate.image( 2, PMAPR_all );
+      }
     
-    if( !( PMAPR_leftU[1] + EPS < 0. && PMAPR_rightU[1] - EPS > 0. && PMAPR_all[0].leftBound() < 0. && PMAPR_all[0].rightBound() > 0.) )
-      throw "RIGHT POINCARE MAP COVERING ERROR! \n";
-
-    IVector URface( setToIntegrateUR[0], ruUR*interval(-1,1), 0. );
-    IVector DRface( rsDR*interval(-1,1), interval( (PMAPR_leftU[1] + EPS).rightBound(), (PMAPR_rightU[1] - EPS).leftBound() ), 0. ); 
- 
-    FhnIsolatingSegment URSegment( Fhn_vf, GammaUR + IVector( 0., 0., setToIntegrateUR[1].leftBound() ), 
-        GammaUR + IVector( 0.,0.,setToIntegrateUR[1].rightBound() ), PUR, URface, URface, _cornerSegmentDivCount );  // TODO: add EPS?
-    FhnIsolatingSegment DRSegment( Fhn_vf, GammaDR + IVector( 0., 0., PMAPR_all[0].leftBound()-EPS ), 
-        GammaDR + IVector( 0., 0., PMAPR_all[0].rightBound()+EPS ), PDR, DRface, DRface, _cornerSegmentDivCount );  // again, v face is expanded by EPS in both directions
- 
-
-    IVector URSegment_entranceVerification( URSegment.entranceVerification() );
-    IVector URSegment_exitVerification( URSegment.exitVerification() );
-    IVector DRSegment_entranceVerification( DRSegment.entranceVerification() );
-    IVector DRSegment_exitVerification( DRSegment.exitVerification() );
-
-    if( _verbose )
+      if( _verbose )
+      {
+        reportPMAPR << "\n ----------------------------- RIGHT POINCARE MAP: --------------------------------- \n \n";
+
+        reportPMAPR << "All enclosures in section coordinates! \n" << "Image enclosure of UR segment exit face through right Poincare map: \n \n" << PMAPR_all << "\n \n" 
+          << "Image enclosure of left unstable edge of UR segment exit face through right Poincare map: \n \n" << PMAPR_leftU << "\n \n" << 
+          "Image enclosure of right unstable edge of UR segment exit face through right Poincare map: \n \n" << PMAPR_rightU << "\n \n";
+        reportPMAPR << "Number of cells integrated (face, left edge, right edge): " << PMAPR_allCells << ", " << PMAPR_leftUCells << ", " << PMAPR_rightUCells << "\n \n";
+      }
+      
+      if( !( PMAPR_leftU[1] + EPS < 0. && PMAPR_rightU[1] - EPS > 0. && PMAPR_all[0].leftBound() < 0. && PMAPR_all[0].rightBound() > 0.) )
+        throw "RIGHT POINCARE MAP COVERING ERROR! \n";
+
+      if( _settings.checkpoint && !PMAPRResumed )
+      {
+        FhnCheckpoint::append( PMAPRImages, PMAPR_leftU );
+        FhnCheckpoint::append( PMAPRImages, PMAPR_rightU );
+        FhnCheckpoint::append( PMAPRImages, PMAPR_all );
+        _settings.checkpoint->store( PMAPRKey, PMAPRImages );
+      }
+    } );
+
+    int URSegmentTask = graph.add( "UR segment", {}, [&]()   // in: setToIntegrateUR; out: URface, URSegment
     {
-      cout << "\n ------------------- UR, DR SEGMENTS ISOLATION: -------------------------- \n \n";
+      FhnStageTimer timer( stats, "UR segment" );
 
-      cout << "Enclosures of scalar product of vector field with entrance faces normals for UR segment: \n \n" << URSegment_entranceVerification << "\n";  
-      cout << "\n --- \n";
-      cout << "Enclosures of scalar product of vector field with exit faces normals for UR segment: \n \n" << URSegment_exitVerification << "\n";
+      URface = IVector( setToIntegrateUR[0], ruUR*interval(-1,1), 0. );
 
-      cout << "\n --- \n";
+      URSegment.reset( new FhnIsolatingSegment( vectorField, GammaUR + IVector( 0., 0., setToIntegrateUR[1].leftBound() ), 
+          GammaUR + IVector( 0.,0.,setToIntegrateUR[1].rightBound() ), PUR, URface, URface, _cornerSegmentDivCount ) );  // TODO: add EPS?
+      URSegment->refineDepth = _settings.faceRefineDepth;
+      URSegment->checkpoint = _settings.checkpoint;
+      URSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::UR_SEGMENT );
 
-      cout << "Enclosures of scalar product of vector field with entrance faces normals for DR segment: \n \n" << DRSegment_entranceVerification << "\n";  
-      cout << "\n --- \n";
-      cout << "Enclosures of scalar product of vector field with exit faces normals for DR segment: \n \n" << DRSegment_exitVerification << "\n";
+      FhnIsolatingSegment::FaceVerification URSegment_faces( URSegment->verifyAllFaces( stopOnWrongSign ) );      // all four faces of a segment in one pass
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, URSegment->evaluationCount );
+      checkViolation( *URSegment, "ISOLATION ERROR FOR UR CORNER SEGMENT! \n" );
 
+      IVector URSegment_entranceVerification( URSegment_faces.entrance() );
+      IVector URSegment_exitVerification( URSegment_faces.exit() );
 
-      cout << "\n --- \n";
-      cout << "\n --- \n";
-    };
-
-    if( !( URSegment_entranceVerification[0] < 0. && URSegment_entranceVerification[1] < 0. && URSegment_exitVerification[0] > 0. && URSegment_exitVerification[1] > 0. ) )
-      throw "ISOLATION ERROR FOR UR CORNER SEGMENT! \n";
-    if( !( DRSegment_entranceVerification[0] < 0. && DRSegment_entranceVerification[1] < 0. && DRSegment_exitVerification[0] > 0. && DRSegment_exitVerification[1] > 0. ) )
-      throw "ISOLATION ERROR FOR DR CORNER SEGMENT! \n";
-
+      if( _verbose )
+      {
+        reportRightSegments << "Enclosures of scalar product of vector field with entrance faces normals for UR segment: \n \n" << URSegment_entranceVerification << "\n";  
+        reportRightSegments << "\n --- \n";
+        reportRightSegments << "Enclosures of scalar product of vector field with exit faces normals for UR segment: \n \n" << URSegment_exitVerification << "\n";
+        reportRightSegments << "\n --- \n";
+        reportRightSegments << "Number of face products evaluated for UR segment: " << URSegment->evaluationCount << "\n";
+        reportRightSegments << "\n --- \n";
+      }
 
-    if( !( URSegment.segmentEnclosure[0] > DRSegment.segmentEnclosure[0] && ULSegment.segmentEnclosure[0] > DLSegment.segmentEnclosure[0] &&
-          URSegment.segmentEnclosure[2] > ULSegment.segmentEnclosure[2] && DRSegment.segmentEnclosure[2] > DLSegment.segmentEnclosure[2]) )
-      throw "CORNER SEGMENTS ALIGNMENT ERROR! \n";          // a check on whether corner segments are really up/down to the left/right of each other
+      if( !( URSegment_entranceVerification[0] < 0. && URSegment_entranceVerification[1] < 0. && URSegment_exitVerification[0] > 0. && URSegment_exitVerification[1] > 0. ) )
+        throw "ISOLATION ERROR FOR UR CORNER SEGMENT! \n";
+    } );
 
+    std::ostringstream reportDRSegment;   // DR runs concurrently with UR, its report is appended to reportRightSegments afterwards
+    reportDRSegment.precision( cout.precision() );
 
-    longIsolatingSegment UpSegment( Fhn_vf, ULSegment.GammaRight, URSegment.GammaLeft, PUL, PUR, ULface, URface, _longSegmentDivCount );
-    longIsolatingSegment DownSegment( Fhn_vf, DLSegment.GammaRight, DRSegment.GammaLeft, PDL, PDR, DLface, DRface, _longSegmentDivCount ); 
+    int DRSegmentTask = graph.add( "DR segment", { rightMapTask }, [&]()   // in: PMAPR_leftU, PMAPR_rightU, PMAPR_all; out: DRface, DRSegment
+    {
+      FhnStageTimer timer( stats, "DR segment" );
 
-    if( !( ULSegment.segmentEnclosure[0] > ULSegment.segmentEnclosure[2] && UpSegment.segmentEnclosure[0] > UpSegment.segmentEnclosure[2] && 
-          URSegment.segmentEnclosure[0] > URSegment.segmentEnclosure[2] ) )
-      throw "MISALIGNMENT OF ONE OF THE UPPER SEGMENTS! \n";
-    if( !( DLSegment.segmentEnclosure[0] < DLSegment.segmentEnclosure[2] && DownSegment.segmentEnclosure[0] < DownSegment.segmentEnclosure[2] && 
-          DRSegment.segmentEnclosure[0] < DRSegment.segmentEnclosure[2] ) )
-      throw "MISALIGNMENT OF ONE OF THE LOWER SEGMENTS! \n";      // checks on whether we are above/below u=v plane for upper/lower segments
+      DRface = IVector( rsDR*interval(-1,1), interval( (PMAPR_leftU[1] + EPS).rightBound(), (PMAPR_rightU[1] - EPS).leftBound() ), 0. ); 
+   
+      DRSegment.reset( new FhnIsolatingSegment( vectorField, GammaDR + IVector( 0., 0., PMAPR_all[0].leftBound()-EPS ), 
+          GammaDR + IVector( 0., 0., PMAPR_all[0].rightBound()+EPS ), PDR, DRface, DRface, _cornerSegmentDivCount ) );  // again, v face is expanded by EPS in both directions
+      DRSegment->refineDepth = _settings.faceRefineDepth;
+      DRSegment->checkpoint = _settings.checkpoint;
+      DRSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::DR_SEGMENT );
+
+      FhnIsolatingSegment::FaceVerification DRSegment_faces( DRSegment->verifyAllFaces( stopOnWrongSign ) );
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, DRSegment->evaluationCount );
+      checkViolation( *DRSegment, "ISOLATION ERROR FOR DR CORNER SEGMENT! \n" );
+
+      IVector DRSegment_entranceVerification( DRSegment_faces.entrance() );
+      IVector DRSegment_exitVerification( DRSegment_faces.exit() );
+
+      if( _verbose )
+      {
+        reportDRSegment << "Enclosures of scalar product of vector field with entrance faces normals for DR segment: \n \n" << DRSegment_entranceVerification << "\n";  
+        reportDRSegment << "\n --- \n";
+        reportDRSegment << "Enclosures of scalar product of vector field with exit faces normals for DR segment: \n \n" << DRSegment_exitVerification << "\n";
+        reportDRSegment << "\n --- \n";
+        reportDRSegment << "Number of face products evaluated for DR segment: " << DRSegment->evaluationCount << "\n";
+        reportDRSegment << "\n --- \n";
+      }
+
+      if( !( DRSegment_entranceVerification[0] < 0. && DRSegment_entranceVerification[1] < 0. && DRSegment_exitVerification[0] > 0. && DRSegment_exitVerification[1] > 0. ) )
+        throw "ISOLATION ERROR FOR DR CORNER SEGMENT! \n";
+    } );
+
+    graph.add( "corner segments alignment", { ULSegmentTask, DLSegmentTask, URSegmentTask, DRSegmentTask }, [&]()   // in: all corner segments
+    {
+      if( !( URSegment->segmentEnclosure[0] > DRSegment->segmentEnclosure[0] && ULSegment->segmentEnclosure[0] > DLSegment->segmentEnclosure[0] &&
+            URSegment->segmentEnclosure[2] > ULSegment->segmentEnclosure[2] && DRSegment->segmentEnclosure[2] > DLSegment->segmentEnclosure[2]) )
+        throw "CORNER SEGMENTS ALIGNMENT ERROR! \n";          // a check on whether corner segments are really up/down to the left/right of each other
+    } );
 
-    IVector UpSegment_entranceAndExitVerification( UpSegment.entranceAndExitVerification( _longSubsegmentCount ) );
-    IVector DownSegment_entranceAndExitVerification( DownSegment.entranceAndExitVerification( _longSubsegmentCount ) );
+    std::ostringstream reportDownSegment;
+    reportDownSegment.precision( cout.precision() );
 
-    if( _verbose )
+    graph.add( "up segment", { ULSegmentTask, URSegmentTask }, [&]()   // in: ULSegment, URSegment, ULface, URface; out: UpSegment
+    {
+      FhnStageTimer timer( stats, "up segment" );
+
+      UpSegment.reset( new longIsolatingSegment( vectorField, dynamicVector( ULSegment->GammaRight ), dynamicVector( URSegment->GammaLeft ), PUL, PUR, ULface, URface, _longSegmentDivCount, upThreads ) );
+
+      if( !( ULSegment->segmentEnclosure[0] > ULSegment->segmentEnclosure[2] && UpSegment->segmentEnclosure[0] > UpSegment->segmentEnclosure[2] && 
+            URSegment->segmentEnclosure[0] > URSegment->segmentEnclosure[2] ) )
+        throw "MISALIGNMENT OF ONE OF THE UPPER SEGMENTS! \n";
+
+      UpSegment->refineDepth = _settings.faceRefineDepth;
+      UpSegment->checkpoint = _settings.checkpoint;
+      UpSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::UP_SEGMENTS );
+
+      IVector UpSegment_entranceAndExitVerification( UpSegment->entranceAndExitVerification( _longSubsegmentCount, stopOnWrongSign ) );
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, UpSegment->evaluationCount );
+      FhnCount( stats, FhnInstrumentation::SUBSEGMENTS, _longSubsegmentCount );
+      FhnCount( stats, FhnInstrumentation::NEWTON_ITERATIONS, UpSegment->newtonIterationCount );
+      checkViolation( *UpSegment, "ISOLATION ERROR FOR ONE OF THE UPPER REGULAR SEGMENTS! \n" );
+
+      if( _verbose )
+      {
+        reportLongSegments << "Interval hull of enclosures of scalar products of the vector field with up segments (not including corner ones, left/right entrance faces first, then exit faces): \n \n"
+          << UpSegment_entranceAndExitVerification << "\n";  
+        reportLongSegments << "Number of face products evaluated for up segments: " << UpSegment->evaluationCount << "\n";
+        reportLongSegments << "\n --- \n";
+      }
+
+      if( !( UpSegment_entranceAndExitVerification[0] < 0. && UpSegment_entranceAndExitVerification[1] < 0. 
+            && UpSegment_entranceAndExitVerification[2] > 0. && UpSegment_entranceAndExitVerification[3] > 0. ) )
+        throw "ISOLATION ERROR FOR ONE OF THE UPPER REGULAR SEGMENTS! \n";
+    } );
+
+    graph.add( "down segment", { DLSegmentTask, DRSegmentTask }, [&]()   // in: DLSegment, DRSegment, DLface, DRface; out: DownSegment
+    {
+      FhnStageTimer timer( stats, "down segment" );
+
+      DownSegment.reset( new longIsolatingSegment( vectorField, dynamicVector( DLSegment->GammaRight ), dynamicVector( DRSegment->GammaLeft ), PDL, PDR, DLface, DRface, _longSegmentDivCount, downThreads ) ); 
+
+      if( !( DLSegment->segmentEnclosure[0] < DLSegment->segmentEnclosure[2] && DownSegment->segmentEnclosure[0] < DownSegment->segmentEnclosure[2] && 
+            DRSegment->segmentEnclosure[0] < DRSegment->segmentEnclosure[2] ) )
+        throw "MISALIGNMENT OF ONE OF THE LOWER SEGMENTS! \n";      // checks on whether we are above/below u=v plane for upper/lower segments
+
+      DownSegment->refineDepth = _settings.faceRefineDepth;
+      DownSegment->checkpoint = _settings.checkpoint;
+      DownSegment->certificate = FhnCertificateStream( _settings.certificate, run, FhnCertificateRecord::DOWN_SEGMENTS );
+
+      IVector DownSegment_entranceAndExitVerification( DownSegment->entranceAndExitVerification( _longSubsegmentCount, stopOnWrongSign ) );
+      FhnCount( stats, FhnInstrumentation::FACE_BOXES, DownSegment->evaluationCount );
+      FhnCount( stats, FhnInstrumentation::SUBSEGMENTS, _longSubsegmentCount );
+      FhnCount( stats, FhnInstrumentation::NEWTON_ITERATIONS, DownSegment->newtonIterationCount );
+      checkViolation( *DownSegment, "ISOLATION ERROR FOR ONE OF THE LOWER REGULAR SEGMENTS! \n" );
+
+      if( _verbose )
+      {
+        reportDownSegment << "Interval hull of enclosures of scalar products of the vector field with down segments (not including corner ones, left/right entrance faces first, then exit faces): \n \n"
+          << DownSegment_entranceAndExitVerification << "\n \n";  
+        reportDownSegment << "Number of face products evaluated for down segments: " << DownSegment->evaluationCount << "\n";
+        reportDownSegment << "\n --- \n";
+      }
+
+      if( !( DownSegment_entranceAndExitVerification[0] < 0. && DownSegment_entranceAndExitVerification[1] < 0. 
+            && DownSegment_entranceAndExitVerification[2] > 0. && DownSegment_entranceAndExitVerification[3] > 0. ) )
+        throw "ISOLATION ERROR FOR ONE OF THE LOWER REGULAR SEGMENTS! \n";
+    } );
+
+    auto displayReports = [&]()   // also after a failure, reports of the finished tasks are displayed
     {
-      cout << "\n ---------------------------- UP, DOWN SEGMENTS ISOLATION: ---------------------------- \n \n";
-
-      cout << "Interval hull of enclosures of scalar products of the vector field with up segments (not including corner ones, left/right entrance faces first, then exit faces): \n \n"
-        << UpSegment_entranceAndExitVerification << "\n";  
-      cout << "\n --- \n";
-      cout << "Interval hull of enclosures of scalar products of the vector field with down segments (not including corner ones, left/right entrance faces first, then exit faces): \n \n"
-        << DownSegment_entranceAndExitVerification << "\n \n";  
- 
-      cout << "\n --- \n";
-      cout << "\n --- \n";   
+      if( !_verbose )
+        return;
+
+      reportLeftSegments << reportDLSegment.str();
+      reportRightSegments << reportDRSegment.str();
+      reportLongSegments << reportDownSegment.str();
+
+      const char* headers[5] = { "", "\n ------------------- UL, DL SEGMENTS ISOLATION: -------------------------- \n \n", "",
+                                 "\n ------------------- UR, DR SEGMENTS ISOLATION: -------------------------- \n \n",
+                                 "\n ---------------------------- UP, DOWN SEGMENTS ISOLATION: ---------------------------- \n \n" };
+      for( int k = 0; k < 5; k++ )
+        if( !reports[k]->str().empty() )
+          out << headers[k] << reports[k]->str() << ( k == 0 || k == 2 ? "" : "\n --- \n" );
     };
 
-    if( !( UpSegment_entranceAndExitVerification[0] < 0. && UpSegment_entranceAndExitVerification[1] < 0. 
-          && UpSegment_entranceAndExitVerification[2] > 0. && UpSegment_entranceAndExitVerification[3] > 0. ) )
-      throw "ISOLATION ERROR FOR ONE OF THE UPPER REGULAR SEGMENTS! \n";
-    if( !( DownSegment_entranceAndExitVerification[0] < 0. && DownSegment_entranceAndExitVerification[1] < 0. 
-          && DownSegment_entranceAndExitVerification[2] > 0. && DownSegment_entranceAndExitVerification[3] > 0. ) )
-      throw "ISOLATION ERROR FOR ONE OF THE LOWER REGULAR SEGMENTS! \n";
+    try
+    {
+      graph.run( threads );
+    }
+    catch(...)
+    {
+      displayReports();
+      throw;
+    }
+    displayReports();
+
+    out << "Existence of a periodic orbit for the FitzHugh-Nagumo system with parameter values theta=" << _theta << " and eps=" << _eps << " verified! \n";
 
-    cout << "Existence of a periodic orbit for the FitzHugh-Nagumo system with parameter values theta=" << _theta << " and eps=" << _eps << " verified! \n";
+    result.verified = 1;
 
+    if( _settings.preprocessingCache && preprocessed )   // like the corner cache below, the cache only keeps what a verification succeeded with
+      _settings.preprocessingCache->store( _theta, _eps, Gammas, Ps );
+
+    if( _settings.cornerCache )     // corners of failed verifications (e.g. corrected to a wrong branch) would spoil the predictions for nearby theta
+      _settings.cornerCache->store( _theta.leftBound(), DVector({ GammaUL[0].leftBound(), GammaDL[0].leftBound(), GammaUR[0].leftBound(), GammaDR[0].leftBound(), 
+                                                         GammaUL[2].leftBound(), GammaUR[2].leftBound() }) );
   }  
   catch(const char* Message)
   {
-    cout << Message << "EXISTENCE OF PERIODIC ORBIT FOR PARAMETER VALUES THETA=" << _theta << " AND EPS=" << _eps << " NOT VERIFIED! \n";
+    if( violationLocations.count( Message ) )
+      result.failedLocation = violationLocations[Message];
+
+    out << Message;
+    if( !result.failedLocation.empty() )
+      out << "FIRST FACE BOX WITHOUT THE REQUIRED SIGN: " << result.failedLocation << "\n";
+    out << "EXISTENCE OF PERIODIC ORBIT FOR PARAMETER VALUES THETA=" << _theta << " AND EPS=" << _eps << " NOT VERIFIED! \n";
+
+    result.failedCheck = Message;
+  }
+  catch(const std::exception& e)  // e.g. CAPD failing to find an enclosure in the rigorous integration, the parameters are not verified either
+  {
+    out << e.what() << "\nEXISTENCE OF PERIODIC ORBIT FOR PARAMETER VALUES THETA=" << _theta << " AND EPS=" << _eps << " NOT VERIFIED! \n";
+
+    result.failedCheck = e.what();
   }
+
+  if( _settings.certificate )
+    _settings.certificate->endRun( run, result.verified, _longSubsegmentCount );   // the records of segments were flushed when they were destroyed
+  result.wallTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  if( stats )
+    result.report = stats->json();
+  return result;
 };
 
 
@@ -8,6 +8,8 @@
  * along the slow manifold.
  * ----------------------------------------------------------------------------------------*/
 
+#include <sstream>
+
 
 
 /* ------------------------------------------------------------------------------------ */
@@ -20,11 +22,12 @@ IMatrix coordChange( IMap vectorField, const IVector& Gamma ) // matrix of coord
 {
   int vdim( Gamma.dimension() );
   DMatrix JacobianD( vdim, vdim );
- 
+  IMatrix Jacobian( vectorField[Gamma] );
+
   for(int i=0; i<vdim; i++)              // we have to convert to doubles to use computeEigenvaluesAndEigenvectors function
   {
     for(int j=0; j<vdim; j++)
-      JacobianD[i][j] = ( ( vectorField[Gamma] )[i][j] ).leftBound();
+      JacobianD[i][j] = Jacobian[i][j].leftBound();
   }
 
   // temporary vectors and matrices to hold eigenvalues & imaginary parts of eigenvectors
@@ -45,261 +48,769 @@ IMatrix coordChange( IMap vectorField, const IVector& Gamma ) // matrix of coord
 };
 
 
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- PHASE SPACE TYPES ------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+// isolating segments always live in the 3d phase space (u,w,v), so their vectors and matrices can have a fixed size known at compile time;
+// compiling with FHN_STATIC_DIMENSION selects these for FhnIsolatingSegment, otherwise the dynamically allocated IVector, IMatrix are used
+// (CAPD solvers, Poincare maps and sets take only the dynamic ones, so geometry passed to them is converted by dynamicVector, dynamicMatrix)
+
+template<int DIM>
+struct FhnSpace         // DIM = 0 - dynamic dimension
+{
+  typedef capd::vectalg::Vector<interval,DIM> Vector;
+  typedef capd::vectalg::Matrix<interval,DIM,DIM> Matrix;
+
+  static Vector vector( const IVector& x )
+  {
+    Vector result( x.dimension() );
+    for(int k=0; k < x.dimension(); k++)
+      result[k] = x[k];
+    return result;
+  }
+
+  static Matrix matrix( const IMatrix& A )
+  {
+    Matrix result( A.numberOfRows(), A.numberOfColumns() );
+    for(int i=0; i < A.numberOfRows(); i++)
+      for(int j=0; j < A.numberOfColumns(); j++)
+        result[i][j] = A[i][j];
+    return result;
+  }
+};
+
+const IVector& dynamicVector( const IVector& x ) { return x; }
+const IMatrix& dynamicMatrix( const IMatrix& A ) { return A; }
+
+template<int DIM>
+IVector dynamicVector( const capd::vectalg::Vector<interval,DIM>& x )
+{
+  IVector result( x.dimension() );
+  for(int k=0; k < x.dimension(); k++)
+    result[k] = x[k];
+  return result;
+}
+
+template<int DIM>
+IMatrix dynamicMatrix( const capd::vectalg::Matrix<interval,DIM,DIM>& A )
+{
+  IMatrix result( A.numberOfRows(), A.numberOfColumns() );
+  for(int i=0; i < A.numberOfRows(); i++)
+    for(int j=0; j < A.numberOfColumns(); j++)
+      result[i][j] = A[i][j];
+  return result;
+}
+
+
 
 /* ----------------------------------------------------------------------------------------- */
 /* ---------------------------- ISOLATING SEGMENTS ----------------------------------------- */
 /* ----------------------------------------------------------------------------------------- */
 
-class FhnIsolatingSegment                 // class for verification of existence of isolating segments
+template<int DIM>
+class FhnIsolatingSegmentT                // class for verification of existence of isolating segments, vectors and matrices of the phase space are those of FhnSpace<DIM>
 {
 public:
+  typedef typename FhnSpace<DIM>::Vector Vector;
+  typedef typename FhnSpace<DIM>::Matrix Matrix;
+
   IMap vectorField;
-  IMatrix P;                              // diagonalization matrix along given slow manifold branch
-  IVector GammaLeft;                      // slow manifold left end point 
-  IVector GammaRight;                     // slow manifold right end point 
-  IVector leftFace;                       // left face of the box (ys x yu centered at 0)
-  IVector rightFace;                      // right face of the box (ys x yu centered at 0)
+  Matrix P;                               // diagonalization matrix along given slow manifold branch
+  Vector GammaLeft;                       // slow manifold left end point 
+  Vector GammaRight;                      // slow manifold right end point 
+  Vector leftFace;                        // left face of the box (ys x yu centered at 0)
+  Vector rightFace;                       // right face of the box (ys x yu centered at 0)
   interval disc;                          // number of discretization points
-  IMatrix InvP;                           // P^(-1)
+  Matrix InvP;                            // P^(-1)
+  Matrix InvPT;                           // P^(-T), transforms normals of faces given in the straightened coordinates
   DiscreteDynSys<IMap> vectorFieldEval;   // this is only to evaluate the vector field on C0Rect2Set in most effective way - not a real dynamical system
-  IVector segmentEnclosure;               // whether we are moving to the right or to the left on the slow variable     
-
-  FhnIsolatingSegment( IMap _vectorField, const IVector& _GammaLeft, const IVector& _GammaRight, const IMatrix& _P, const IVector& _leftFace, const IVector& _rightFace, interval _disc )
+  Vector segmentEnclosure;                // whether we are moving to the right or to the left on the slow variable     
+  IFhnVectorField kernel;                 // hand-written vector field used for the face products instead of the IMap (see vectorfield.hpp)
+  bool useKernel;                         // whether face products are evaluated by kernel or by moving C0Rect2Sets by vectorFieldEval
+  bool useBatch;                          // whether verifyFaces evaluates kernel products a whole face row at a time (see facebatch.hpp)
+  int refineDepth;                        // if positive, verifyFaces starts from a grid about 2^refineDepth times coarser than disc x disc and bisects only boxes
+                                          // whose products do not have the required sign, at most refineDepth times (0 - uniform disc x disc grid)
+  long evaluationCount;                   // number of face products evaluated by the last call of verifyFaces
+  FhnCheckpoint* checkpoint;              // if set, verifyAllFaces takes the products of an already verified segment of exactly this geometry from it (0 - none)
+  FhnCertificateStream certificate;       // if it has a writer, verifyFaces records the product on every face box there (see certificate.hpp)
+  Vector scratchGamma;                    // scratch vectors of refineFaceProduct, reused for all boxes so that no vectors are allocated per box
+  Vector scratchRow;
+  Vector scratchCell;
+
+  FhnIsolatingSegmentT( IMap _vectorField, const IVector& _GammaLeft, const IVector& _GammaRight, const IMatrix& _P, const IVector& _leftFace, const IVector& _rightFace, interval _disc )
     : vectorField(_vectorField), 
-      P(_P),
-      GammaLeft(_GammaLeft),
-      GammaRight(_GammaRight),
-      leftFace(_leftFace),
-      rightFace(_rightFace),
+      P( FhnSpace<DIM>::matrix(_P) ),
+      GammaLeft( FhnSpace<DIM>::vector(_GammaLeft) ),
+      GammaRight( FhnSpace<DIM>::vector(_GammaRight) ),
+      leftFace( FhnSpace<DIM>::vector(_leftFace) ),
+      rightFace( FhnSpace<DIM>::vector(_rightFace) ),
       disc(_disc),
       InvP(inverseMatrix(P)),
+      InvPT(Transpose(InvP)),
       vectorFieldEval(vectorField),
-      segmentEnclosure( intervalHull( GammaLeft + P*leftFace, GammaRight + P*rightFace ) ) // a rough enclosure for the isolating segment to check whether
-                                                                                           // slow vector field is moving in one direction only
+      segmentEnclosure( intervalHull( GammaLeft + P*leftFace, GammaRight + P*rightFace ) ), // a rough enclosure for the isolating segment to check whether
+                                                                                            // slow vector field is moving in one direction only
+      kernel( vectorField.getParameter("theta"), vectorField.getParameter("eps") ),
+      useKernel( 1 ),
+      useBatch( 1 ),
+      refineDepth( 0 ),
+      evaluationCount( 0 ),
+      checkpoint( 0 ),
+      scratchGamma( 3 ),
+      scratchRow( 3 ),
+      scratchCell( 3 )
   {
     if( !intersectionIsEmpty( IVector( {segmentEnclosure[0]} ), IVector( {segmentEnclosure[2]} ) ) )   // check whether slow vector field goes in one direction, assumes nonlinearity
       throw "ZERO OF THE SLOW SUBSYSTEM DETECTED IN ONE OF THE SEGMENTS! \n";       // is const*(u-v), const>0
   }
 
 
-  // ------------- entrance verification --------------------
+  // ------------- faces of the segment --------------------
+
+  enum Face { SL = 0, SR = 1, UL = 2, UR = 3 };  // stable left/right faces (entrance) and unstable left/right faces (exit)
+
+  struct FaceVerification                 // enclosures of scalar products of the vector field with outward normals of each face
+  {
+    interval product[4];                  // indexed by Face
+
+    IVector entrance() const { return IVector({ product[SL], product[SR] }); }
+    IVector exit() const { return IVector({ product[UL], product[UR] }); }
+  };
+
+  struct FaceViolation                    // a face box on which the product does not have the required sign, found by verifyFaces with _stopOnWrongSign
+  {
+    int face;                             // -1 if there is none
+    int subsegment;                       // index of the subsegment of a long segment, -1 otherwise
+    interval ti;                          // fraction of the slow variable
+    interval tj;                          // fraction of the face along the coordinate which is not fixed
+    IVector box;                          // the box Gamma_i + P*face_ij in phase space
+    interval product;
+
+    FaceViolation() : face( -1 ), subsegment( -1 ), box( 3 ) {}
+
+    std::string location() const          // one line without commas, for reports of failed checks
+    {
+      const char* names[4] = { "SL", "SR", "UL", "UR" };
+      std::ostringstream text;
+      text.precision(9);
+      text << names[face] << " face";
+      if( subsegment >= 0 )
+        text << " of subsegment " << subsegment;
+      text << " at slow fraction " << ti.leftBound() << ":" << ti.rightBound() << " face fraction " << tj.leftBound() << ":" << tj.rightBound()
+           << " box u " << box[0].leftBound() << ":" << box[0].rightBound() << " w " << box[1].leftBound() << ":" << box[1].rightBound()
+           << " v " << box[2].leftBound() << ":" << box[2].rightBound() << " product " << product.leftBound() << ":" << product.rightBound();
+      return text.str();
+    }
+  };
 
+  FaceViolation violation;                // set by the last call of verifyFaces with _stopOnWrongSign
 
-  IVector entranceVerification() // all normals are outward pointing
+  Vector faceNormal( int face ) // all normals are outward pointing
   {
-    IVector normalSL( -1., 0., -( (InvP*GammaRight)[0] + rightFace[0].leftBound() - ( (InvP*GammaLeft)[0] + leftFace[0].leftBound() ) )/( GammaRight[2] - GammaLeft[2] ) );
-    IVector normalSR( 1., 0., -( (InvP*GammaRight)[0] + rightFace[0].rightBound() - ( (InvP*GammaLeft)[0] + leftFace[0].rightBound() ) )/( GammaRight[2] - GammaLeft[2] ) );   
+    int c( face < UL ? 0 : 1 );           // coordinate fixed on the face - stable for entrance faces, unstable for exit faces
+    bool right( face == SR || face == UR );
+
+    Vector normal( 0., 0., -( (InvP*GammaRight)[c] + ( right ? rightFace[c].rightBound() : rightFace[c].leftBound() ) 
+                                 - ( (InvP*GammaLeft)[c] + ( right ? leftFace[c].rightBound() : leftFace[c].leftBound() ) ) )/( GammaRight[2] - GammaLeft[2] ) );
+    normal[c] = ( right ? 1. : -1. );
         // outward normal to (t(b-a)+a, s, t(v2-v1)+v1) is (-1,0,-(b-a)/(v2-v1)), a < 0 (left)
         // here a = (P-1(gammaleft))[0] + leftface[0].leftbound, b = (P-1(gammaright))[0] + rightface[0].leftbound so later we need to transform whole segment by P
-        // to obtain the normal stable "left" vector
-        // for normal stable "right" vector we do the same 
+        // to obtain the normal stable "left" vector; for normal stable "right" vector we do the same
+        // again, outward normal to (s, t(b-a)+a, t(v2-v1)+v1) is (0, -1,-(b-a)/(v2-v1)) for a < 0 for unstable left normal, same for unstable right normal ( a > 0 )
     
-    normalSL = Transpose(InvP)*normalSL; // normals under affine (linear = P) transformations are transformed under inverse transpose of the transformation
-    normalSR = Transpose(InvP)*normalSR;
-   
-    interval NormalSLxVectorField;
-    interval NormalSRxVectorField;
+    return InvPT*normal;           // normals under affine (linear = P) transformations are transformed under inverse transpose of the transformation
+  }
 
-    for(int i=1; i <= disc; i++)
-    {
-      interval ti = interval(i-1, i)/disc;
+  void slowPoint( const interval& ti, Vector& Gamma_i ) // ( GammaRight - GammaLeft )*ti + GammaLeft computed coordinatewise into Gamma_i, without temporary vectors
+  {
+    for(int k=0; k < 3; k++)
+      Gamma_i[k] = ( GammaRight[k] - GammaLeft[k] )*ti + GammaLeft[k];
+  }
 
-      IVector Gamma_i( ( GammaRight - GammaLeft )*ti + GammaLeft );
-  
-      // stable left evaluation
+  Vector faceRow( int face, const interval& ti ) // part of the face over [ti] fraction of the slow variable (ys x yu centered at 0)
+  {
+    Vector face_i(3);
+    faceRow( face, ti, face_i );
+    return face_i;
+  }
 
-      IVector faceSL_i(3);
-      faceSL_i[0] = ( rightFace[0].leftBound() - leftFace[0].leftBound() )*ti + leftFace[0].leftBound(); 
-      faceSL_i[1] = interval( ( ( rightFace[1].leftBound() - leftFace[1].leftBound() )*ti + leftFace[1].leftBound() ).leftBound(), // remove some leftBounds?
-                                      ( ( rightFace[1].rightBound() - leftFace[1].rightBound() )*ti + leftFace[1].rightBound() ).rightBound() ); // remove some rightBounds?
-      faceSL_i[2] = 0.; 
+  void faceRow( int face, const interval& ti, Vector& face_i ) // the same stored into face_i of dimension 3
+  {
+    int c( face < UL ? 0 : 1 );           // fixed coordinate
+    int o( 1 - c );                       // coordinate along the face
+    bool right( face == SR || face == UR );
+
+    if( right )
+      face_i[c] = ( rightFace[c].rightBound() - leftFace[c].rightBound() )*ti + leftFace[c].rightBound();
+    else
+      face_i[c] = ( rightFace[c].leftBound() - leftFace[c].leftBound() )*ti + leftFace[c].leftBound(); 
+    face_i[o] = interval( ( ( rightFace[o].leftBound() - leftFace[o].leftBound() )*ti + leftFace[o].leftBound() ).leftBound(), // remove some leftBounds?
+                                 ( ( rightFace[o].rightBound() - leftFace[o].rightBound() )*ti + leftFace[o].rightBound() ).rightBound() ); // remove some rightBounds?
+    face_i[2] = 0.;
+  }
 
-      // stable right evaluation
+  interval faceCellCoordinate( int face, const Vector& face_i, const interval& tj ) // [tj] fraction of a face row along the face, only the coordinate along the face
+  {
+    int o( face < UL ? 1 : 0 );
 
-      IVector faceSR_i(3);
-      faceSR_i[0] = ( rightFace[0].rightBound() - leftFace[0].rightBound() )*ti + leftFace[0].rightBound();
-      faceSR_i[1] = interval( (  ( rightFace[1].leftBound() - leftFace[1].leftBound() )*ti + leftFace[1].leftBound() ).leftBound(), // remove some leftBounds?
-                                       ( ( rightFace[1].rightBound() - leftFace[1].rightBound() )*ti + leftFace[1].rightBound() ).rightBound() ); // remove some rightBounds?
-      faceSR_i[2] = 0.;
- 
-      for(int j=1; j <= disc; j++)
+    return ( face_i[o].rightBound() - face_i[o].leftBound() )*tj + face_i[o].leftBound();
+  }
+
+  Vector faceCell( int face, const Vector& face_i, const interval& tj ) // [tj] fraction of a face row along the face
+  {
+    Vector face_ij( face_i );
+    face_ij[ face < UL ? 1 : 0 ] = faceCellCoordinate( face, face_i, tj );
+    return face_ij;
+  }
+
+  void faceCell( int face, const Vector& face_i, const interval& tj, Vector& face_ij ) // the same stored into face_ij of dimension 3
+  {
+    for(int k=0; k < 3; k++)
+      face_ij[k] = face_i[k];
+    face_ij[ face < UL ? 1 : 0 ] = faceCellCoordinate( face, face_i, tj );
+  }
+
+  interval faceProduct( const Vector& Gamma_i, const Vector& face_ij, const Vector& normal ) // scalar product of the vector field on a face cell with the face normal
+  {
+    if( useKernel )
+      return kernelFaceProduct( Gamma_i, face_ij, normal );
+    return capdFaceProduct( Gamma_i, face_ij, normal );
+  }
+
+  interval capdFaceProduct( const Vector& Gamma_i, const Vector& face_ij, const Vector& normal ) // the same by moving a C0Rect2Set by vectorFieldEval (the IMap)
+  {
+    C0Rect2Set Cface_ij( dynamicVector(Gamma_i), dynamicMatrix(P), dynamicVector(face_ij) );
+    Cface_ij.move(vectorFieldEval);
+    IVector vectorField_ij(Cface_ij);
+
+    return scalarProduct(vectorField_ij, dynamicVector(normal));
+  }
+
+  interval kernelFaceProduct( const Vector& Gamma_i, const Vector& face_ij, const Vector& normal ) 
+    // the same by the hand-written vector field: for X = Gamma_i + P*face_ij and the center xc = Gc + P*yc (Gc, yc middle points of Gamma_i, face_ij)
+    // the product is enclosed by the mean value form n.f(xc) + n^T Df(X) (Gamma_i - Gc) + n^T Df(X) P (face_ij - yc) intersected with the natural enclosure n.f(X)
+  {
+    interval X[3], xc[3], dGamma[3], dFace[3];
+
+    for(int k=0; k < 3; k++)
+    {
+      dGamma[k] = Gamma_i[k] - Gamma_i[k].mid();
+      dFace[k] = face_ij[k] - face_ij[k].mid();
+    }
+    for(int r=0; r < 3; r++)
+    {
+      X[r] = Gamma_i[r];
+      xc[r] = Gamma_i[r].mid();
+      for(int k=0; k < 3; k++)
       {
-        interval tj = interval(j-1, j)/disc;
+        X[r] += P[r][k]*face_ij[k];
+        xc[r] += P[r][k]*face_ij[k].mid();
+      }
+    }
 
-        IVector faceSL_ij(faceSL_i);
-        faceSL_ij[1] = ( faceSL_i[1].rightBound() - faceSL_i[1].leftBound() )*tj + faceSL_i[1].leftBound();
+    interval fX[3], fc[3], J[3][3];
+    kernel( X, fX );
+    kernel( xc, fc );
+    kernel.jacobian( X, J );
 
-        IVector faceSR_ij(faceSR_i);
-        faceSR_ij[1] = ( faceSR_i[1].rightBound() - faceSR_i[1].leftBound() )*tj + faceSR_i[1].leftBound();
+    interval natural(0.), meanValue(0.);
+    for(int r=0; r < 3; r++)
+    {
+      natural += normal[r]*fX[r];
+      meanValue += normal[r]*fc[r];
+    }
+    interval nJ[3];                       // n^T Df(X)
+    for(int k=0; k < 3; k++)
+    {
+      nJ[k] = 0.;
+      for(int r=0; r < 3; r++)
+        nJ[k] += normal[r]*J[r][k];
+      meanValue += nJ[k]*dGamma[k];
+    }
+    for(int k=0; k < 3; k++)
+    {
+      interval nJP_k(0.);                 // k-th coordinate of n^T Df(X) P
+      for(int r=0; r < 3; r++)
+        nJP_k += nJ[r]*P[r][k];
+      meanValue += nJP_k*dFace[k];
+    }
 
-        C0Rect2Set CfaceSL_ij(Gamma_i, P, faceSL_ij);
-        C0Rect2Set CfaceSR_ij(Gamma_i, P, faceSR_ij);
-        
-        CfaceSL_ij.move(vectorFieldEval);
-        CfaceSR_ij.move(vectorFieldEval);
-         
-        IVector vectorFieldSL_ij(CfaceSL_ij);
-        IVector vectorFieldSR_ij(CfaceSR_ij);
+    interval product;
+    if( !intersection( natural, meanValue, product ) )
+      throw "EMPTY INTERSECTION OF VECTOR FIELD ENCLOSURES! \n";  // both are enclosures of the same set, this can only be a bug
+    return product;
+  }
 
-        if( i==1 && j==1 )
+
+  bool kernelSelfTest( int _samples = 4 ) 
+    // whether the kernel and batch products on _samples x _samples boxes of each face, spread over the disc x disc grid, agree with the products of the IMap
+    // by C0Rect2Sets: all three enclose the product on the box, so they have to intersect, and the kernel and batch ones have to contain the IMap product
+    // at the center of the box; verifyFaces runs it before any kernel product is used (see also FhnVectorFieldSelfTest)
+  {
+    int discCount( disc.leftBound() );
+    int samples( _samples < discCount ? _samples : discCount );
+    FhnFaceBatch batch;
+    std::vector<double> cellNlo( samples ), cellHi( samples ), productNlo( samples ), productHi( samples );
+    Vector Gamma_i(3), face_i(3), face_ij(3), GammaCenter(3), faceCenter(3);
+    interval common;
+
+    for(int f = SL; f <= UR; f++)
+    {
+      Vector normal( faceNormal(f) );
+
+      for(int a=0; a < samples; a++)
+      {
+        int i( samples > 1 ? 1 + a*( discCount - 1 )/( samples - 1 ) : 1 );
+        interval ti( interval(i-1, i)/disc );
+        slowPoint( ti, Gamma_i );
+        faceRow( f, ti, face_i );
+
+        for(int b=0; b < samples; b++)
         {
-          NormalSLxVectorField = scalarProduct(vectorFieldSL_ij, normalSL);
-          NormalSRxVectorField = scalarProduct(vectorFieldSR_ij, normalSR);
+          int j( samples > 1 ? 1 + b*( discCount - 1 )/( samples - 1 ) : 1 );
+          interval cell( faceCellCoordinate( f, face_i, interval(j-1, j)/disc ) );
+          cellNlo[b] = -cell.leftBound();
+          cellHi[b] = cell.rightBound();
         }
-        else
+        batch.setRow( kernel, P, Gamma_i, face_i, normal, f < UL ? 0 : 1 );
+        batch.evaluateRow( samples, cellNlo.data(), cellHi.data(), productNlo.data(), productHi.data() );
+
+        for(int b=0; b < samples; b++)
         {
-          NormalSLxVectorField = intervalHull( NormalSLxVectorField, scalarProduct(vectorFieldSL_ij, normalSL) ); 
-          NormalSRxVectorField = intervalHull( NormalSRxVectorField, scalarProduct(vectorFieldSR_ij, normalSR) );
+          int j( samples > 1 ? 1 + b*( discCount - 1 )/( samples - 1 ) : 1 );
+          faceCell( f, face_i, interval(j-1, j)/disc, face_ij );
+          for(int k=0; k < 3; k++)
+          {
+            GammaCenter[k] = Gamma_i[k].mid();
+            faceCenter[k] = face_ij[k].mid();
+          }
+
+          interval kernelProduct( kernelFaceProduct( Gamma_i, face_ij, normal ) ), batchProduct( -productNlo[b], productHi[b] );
+          interval capdProduct( capdFaceProduct( Gamma_i, face_ij, normal ) ), centerProduct( capdFaceProduct( GammaCenter, faceCenter, normal ) );
+
+          if( !intersection( kernelProduct, capdProduct, common ) || !intersection( batchProduct, capdProduct, common ) 
+              || !subset( centerProduct, kernelProduct ) || !subset( centerProduct, batchProduct ) )
+            return 0;
         }
+      }
+    }
+    return 1;
+  }
+
 
+  // ------------- entrance and exit verification --------------------
+
+  static bool hasRequiredSign( int face, const interval& product ) // the vector field points inwards on entrance faces and outwards on exit faces
+  {
+    return ( face < UL ? product < 0. : product > 0. );
+  }
+
+  void setViolation( int face, const interval& ti, const interval& tj, const interval& product )
+  {
+    setViolation( face, ti, tj, product, ( GammaRight - GammaLeft )*ti + GammaLeft, faceCell( face, faceRow( face, ti ), tj ) );
+  }
+
+  void setViolation( int face, const interval& ti, const interval& tj, const interval& product, const Vector& Gamma_i, const Vector& face_ij ) // the box evaluated is given
+  {
+    violation.face = face;
+    violation.ti = ti;
+    violation.tj = tj;
+    violation.box = dynamicVector( Gamma_i + P*face_ij );
+    violation.product = product;
+  }
+
+  interval rowRange( int face, const interval& ti ) // coordinate along the face of the row over [ti], the range refineFaceProduct bisects
+  {
+    return faceRow( face, ti )[ face < UL ? 1 : 0 ];
+  }
+
+  bool refineFaceProduct( int face, const Vector& normal, const interval& ti, const interval& range, const interval& tj, int depth, interval& hull, bool& first, 
+                          bool stopOnWrongSign )
+    // product on the box [ti] x [tj] of the face, where tj is a fraction of range - the coordinate along the face of the row of the coarse box, which is
+    // at least as wide as the row over any part of its [ti] (the face width changes linearly with the slow variable); the box is bisected in both ti and tj
+    // as long as the product does not have the required sign and depth > 0, the halves of tj split the same range, so the final boxes cover the coarse box;
+    // products on the final boxes are added to hull (first - hull is not set yet); with stopOnWrongSign returns 0 at the first final box without the required sign
+  {
+    slowPoint( ti, scratchGamma );        // the scratch vectors are not used after the product, so recursive calls may overwrite them
+    faceRow( face, ti, scratchRow );      // the fixed coordinate is that of [ti], along the face the range of the coarse row is kept
+    scratchRow[ face < UL ? 1 : 0 ] = range;
+    faceCell( face, scratchRow, tj, scratchCell );
+    interval product( faceProduct( scratchGamma, scratchCell, normal ) );
+    evaluationCount++;
+
+    if( depth == 0 || hasRequiredSign( face, product ) )
+    {
+      if( certificate.writer )
+        certificate.faceBox( face, ti, tj, product );
+      hull = ( first ? product : intervalHull( hull, product ) );
+      first = 0;
+      if( stopOnWrongSign && !hasRequiredSign( face, product ) )
+      {
+        setViolation( face, ti, tj, product, scratchGamma, scratchCell );
+        return 0;
       }
+      return 1;
     }
 
-    return IVector({NormalSLxVectorField, NormalSRxVectorField});
-  } 
+    double mid_i( ( ti.leftBound() + ti.rightBound() )/2. ),   // halves share the split point, so no fraction between them is left out
+           mid_j( ( tj.leftBound() + tj.rightBound() )/2. );
+    interval half_i[2] = { interval( ti.leftBound(), mid_i ), interval( mid_i, ti.rightBound() ) },
+             half_j[2] = { interval( tj.leftBound(), mid_j ), interval( mid_j, tj.rightBound() ) };
+
+    for(int a=0; a < 2; a++)
+      for(int b=0; b < 2; b++)
+        if( !refineFaceProduct( face, normal, half_i[a], range, half_j[b], depth-1, hull, first, stopOnWrongSign ) )
+          return 0;
+    return 1;
+  }
 
+  FaceVerification verifyFaces( bool _entrance = 1, bool _exit = 1, bool _stopOnWrongSign = 0 ) 
+    // all four faces are evaluated in one pass over the disc x disc grid sharing Gamma_i and ti, tj, faces which are not requested are left as zero
+    // with _stopOnWrongSign the sweep stops at the first box whose product does not have the required sign and stores it in violation,
+    // the products returned then only cover the boxes evaluated so far (including that one, so they do not have the required sign either)
+  {
+    FaceVerification result;
+    violation = FaceViolation();
+    int firstFace( _entrance ? SL : UL );
+    int lastFace( _exit ? UR : SR );
 
-  // ---------------------------- exit verification -------------------------------------------
+    Vector normal[4];
+    for(int f = firstFace; f <= lastFace; f++)
+    {
+      normal[f] = faceNormal(f);
+      result.product[f] = 0.;
+    }
 
+    int discCount( disc.leftBound() );
+    evaluationCount = 0;
 
-  IVector exitVerification() // all normals are outward pointing
-  {    
-    IVector normalUL( 0., -1., -( (InvP*GammaRight)[1] + rightFace[1].leftBound() - ( (InvP*GammaLeft)[1] + leftFace[1].leftBound() ) )/( GammaRight[2] - GammaLeft[2] ) );
-    IVector normalUR( 0., 1., -( (InvP*GammaRight)[1] + rightFace[1].rightBound() - ( (InvP*GammaLeft)[1] + leftFace[1].rightBound() ) )/( GammaRight[2] - GammaLeft[2] ) );
-        // again, outward normal to (s, t(b-a)+a, t(v2-v1)+v1) is (0, -1,-(b-a)/(v2-v1)) for a < 0
-        // here a = (P-1(gammaleft))[1] + leftface[1].leftbound, b = (P-1(gammaright))[1] + rightface[1].leftbound so later we need to transform whole segment by P
-        // same for unstable right normal ( a > 0 )
+    if( useKernel && !kernelSelfTest() )
+      throw "HAND-WRITTEN VECTOR FIELD DISAGREES WITH THE IMAP ON FACE BOXES! \n";
 
-    normalUL = Transpose(InvP)*normalUL; // normals under affine transformations are transformed under inverse transpose of the transformation
-    normalUR = Transpose(InvP)*normalUR;
-    
-    interval NormalULxVectorField;
-    interval NormalURxVectorField;
+    if( refineDepth > 0 )
+    {
+      int coarseDisc( ( discCount + ( 1 << refineDepth ) - 1 ) >> refineDepth );   // the finest boxes are about as large as cells of the uniform grid
+      if( coarseDisc < 1 )
+        coarseDisc = 1;
+
+      for(int f = firstFace; f <= lastFace; f++)
+      {
+        bool first( 1 );
+        for(int i=1; i <= coarseDisc; i++)
+        {
+          interval ti( interval(i-1, i)/coarseDisc );
+          interval range( rowRange( f, ti ) );
+          for(int j=1; j <= coarseDisc; j++)
+            if( !refineFaceProduct( f, normal[f], ti, range, interval(j-1, j)/coarseDisc, refineDepth, result.product[f], first, _stopOnWrongSign ) )
+              return result;
+        }
+      }
+      return result;
+    }
+
+    FhnFaceBatch batch;
+    std::vector<double> cellNlo( discCount ), cellHi( discCount ), productNlo( discCount ), productHi( discCount );  // one face row as structure of arrays
+
+    Vector Gamma_i(3);                    // vectors of the sweep are allocated once and overwritten for every row and cell
+    Vector face_i[4] = { Vector(3), Vector(3), Vector(3), Vector(3) };
+    Vector face_ij[4] = { Vector(3), Vector(3), Vector(3), Vector(3) };
 
     for(int i=1; i <= disc; i++)
     {
       interval ti = interval(i-1, i)/disc;
 
-      IVector Gamma_i( ( GammaRight - GammaLeft )*ti + GammaLeft );
-  
-      // unstable left evaluation
-          
-      IVector faceUL_i(3);
-      faceUL_i[0] = interval( ( ( rightFace[0].leftBound() - leftFace[0].leftBound() )*ti + leftFace[0].leftBound() ).leftBound(), // remove some leftBounds?
-                                       ( ( rightFace[0].rightBound() - leftFace[0].rightBound() )*ti + leftFace[0].rightBound() ).rightBound() ); // remove some rightBounds?
-      faceUL_i[1] = ( rightFace[1].leftBound() - leftFace[1].leftBound() )*ti + leftFace[1].leftBound();
-      faceUL_i[2] = 0.;
- 
-      // unstable right evaluation
-
-      IVector faceUR_i(3);
-      faceUR_i[0] = interval( ( ( rightFace[0].leftBound() - leftFace[0].leftBound() )*ti + leftFace[0].leftBound() ).leftBound(), // remove some leftBounds?
-                                       ( ( rightFace[0].rightBound() - leftFace[0].rightBound() )*ti + leftFace[0].rightBound() ).rightBound() ); // remove some rightBounds?
-      faceUR_i[1] = ( rightFace[1].rightBound() - leftFace[1].rightBound() )*ti + leftFace[1].rightBound();
-      faceUR_i[2] = 0.;
-      
-      for(int j=1; j <= disc; j++)
+      slowPoint( ti, Gamma_i );
+
+      for(int f = firstFace; f <= lastFace; f++)
+      {
+        faceRow( f, ti, face_i[f] );
+        face_ij[f] = face_i[f];           // cells of the row only differ in the coordinate along the face
+      }
+
+      if( useKernel && useBatch )
       {
-          interval tj = interval(j-1, j)/disc;
+        for(int f = firstFace; f <= lastFace; f++)
+        {
+          batch.setRow( kernel, P, Gamma_i, face_i[f], normal[f], f < UL ? 0 : 1 );
 
-          IVector faceUL_ij(faceUL_i);
-          faceUL_ij[0] = ( faceUL_i[0].rightBound() - faceUL_i[0].leftBound() )*tj + faceUL_i[0].leftBound();
+          for(int j=1; j <= disc; j++)
+          {
+            interval cell( faceCellCoordinate( f, face_i[f], interval(j-1, j)/disc ) );
+            cellNlo[j-1] = -cell.leftBound();
+            cellHi[j-1] = cell.rightBound();
+          }
 
-          IVector faceUR_ij(faceUR_i);
-          faceUR_ij[0] = ( faceUR_i[0].rightBound() - faceUR_i[0].leftBound() )*tj + faceUR_i[0].leftBound();
+          interval product( batch.evaluateRow( discCount, cellNlo.data(), cellHi.data(), productNlo.data(), productHi.data() ) );
+          evaluationCount += discCount;
 
-          C0Rect2Set CfaceUL_ij(Gamma_i, P, faceUL_ij);
-          C0Rect2Set CfaceUR_ij(Gamma_i, P, faceUR_ij);
+          if( certificate.writer )
+            for(int j=1; j <= disc; j++)
+              certificate.faceBox( f, ti, interval(j-1, j)/disc, interval( -productNlo[j-1], productHi[j-1] ) );
 
-          CfaceUL_ij.move(vectorFieldEval);
-          CfaceUR_ij.move(vectorFieldEval);
-      
-          IVector vectorFieldUR_ij(CfaceUR_ij);
-          IVector vectorFieldUL_ij(CfaceUL_ij);
-           
-          if( i==1 && j==1 )
+          if( i==1 )
+            result.product[f] = product;
+          else
+            result.product[f] = intervalHull( result.product[f], product ); 
+
+          if( _stopOnWrongSign && !hasRequiredSign( f, product ) )
           {
-           NormalULxVectorField = scalarProduct(vectorFieldUL_ij, normalUL);
-           NormalURxVectorField = scalarProduct(vectorFieldUR_ij, normalUR);
+            for(int j=1; j <= disc; j++)      // the first cell of the row without the required sign
+            {
+              interval cellProduct( -productNlo[j-1], productHi[j-1] );
+              if( !hasRequiredSign( f, cellProduct ) )
+              {
+                setViolation( f, ti, interval(j-1, j)/disc, cellProduct );
+                return result;
+              }
+            }
           }
+        }
+        continue;
+      }
+ 
+      for(int j=1; j <= disc; j++)
+      {
+        interval tj = interval(j-1, j)/disc;
+
+        for(int f = firstFace; f <= lastFace; f++)
+        {
+          face_ij[f][ f < UL ? 1 : 0 ] = faceCellCoordinate( f, face_i[f], tj );
+          interval product( faceProduct( Gamma_i, face_ij[f], normal[f] ) );
+          evaluationCount++;
+          if( certificate.writer )
+            certificate.faceBox( f, ti, tj, product );
+
+          if( i==1 && j==1 )
+            result.product[f] = product;
           else
+            result.product[f] = intervalHull( result.product[f], product ); 
+
+          if( _stopOnWrongSign && !hasRequiredSign( f, product ) )
           {
-           NormalULxVectorField = intervalHull( NormalULxVectorField, scalarProduct(vectorFieldUL_ij, normalUL) );
-           NormalURxVectorField = intervalHull( NormalURxVectorField, scalarProduct(vectorFieldUR_ij, normalUR) );
+            setViolation( f, ti, tj, product );
+            return result;
           }
+        }
+      }
+    }
+
+    return result;
+  } 
+
+  FhnCheckpoint::Hash checkpointKey() // everything the products of verifyFaces depend on
+  {
+    FhnCheckpoint::Hash key( "isolating segment faces" );
+    key.add( vectorField.getParameter("theta") ).add( vectorField.getParameter("eps") );
+    key.addVector( GammaLeft ).addVector( GammaRight ).addMatrix( P ).addVector( leftFace ).addVector( rightFace );
+    key.add( disc ).add( int( useKernel ) ).add( int( useBatch ) ).add( refineDepth );
+    return key;
+  }
+
+  FaceVerification verifyAllFaces( bool _stopOnWrongSign = 0 ) 
+    // verifyFaces(1, 1, _stopOnWrongSign) unless checkpoint has the products of this segment, products of the required sign are stored in checkpoint;
+    // segments writing a certificate are always verified, so that it has the products on all face boxes
+  {
+    std::vector<double> payload;
+    FaceVerification result;
+
+    if( certificate.writer )
+      certificate.writer->writeGeometry( geometryLine() );
+
+    if( checkpoint && !certificate.writer && checkpoint->load( checkpointKey(), payload ) )
+    {
+      size_t position( 0 );
+      IVector products( FhnCheckpoint::extract( payload, position ) );
+      for(int f = SL; f <= UR; f++)
+        result.product[f] = products[f];
+      violation = FaceViolation();
+      evaluationCount = 0;
+      return result;
+    }
+
+    result = verifyFaces( 1, 1, _stopOnWrongSign );
+
+    if( checkpoint && violation.face < 0 && hasRequiredSign( SL, result.product[SL] ) && hasRequiredSign( SR, result.product[SR] ) 
+        && hasRequiredSign( UL, result.product[UL] ) && hasRequiredSign( UR, result.product[UR] ) )
+    {
+      FhnCheckpoint::append( payload, IVector({ result.product[SL], result.product[SR], result.product[UL], result.product[UR] }) );
+      checkpoint->store( checkpointKey(), payload );
+    }
+    return result;
+  }
+
+  std::string geometryLine() // everything fhn-check needs to verify the faces again, in the format of the geometry file of certificates (see certificate.hpp)
+  {
+    std::ostringstream line;
+    line.precision(17);
+    line << "segment " << certificate.run << " " << certificate.stage << " " << certificate.subsegment << " " << disc.leftBound() << " " << refineDepth;
+    FhnWriteVector( line, IVector({ vectorField.getParameter("theta"), vectorField.getParameter("eps") }) );
+    FhnWriteVector( line, GammaLeft );
+    FhnWriteVector( line, GammaRight );
+    FhnWriteMatrix( line, P );
+    FhnWriteVector( line, leftFace );
+    FhnWriteVector( line, rightFace );
+    return line.str();
+  }
+
+  int faceRowCount() // number of rows of the grid verifyFaces starts from on each face
+  {
+    int discCount( disc.leftBound() );
+    if( refineDepth <= 0 )
+      return discCount;
+    int coarseDisc( ( discCount + ( 1 << refineDepth ) - 1 ) >> refineDepth );
+    return ( coarseDisc < 1 ? 1 : coarseDisc );
+  }
+
+  bool verifyFaceRow( int face, int i, interval& hull ) 
+    // products on the boxes of row i = 1, ..., faceRowCount() of one face as in verifyFaces, added to hull, whether they all have the required sign
+    // (stops at the first box which does not, see violation); rows are independent of each other, so fhn-check verifies them in parallel,
+    // products are evaluated one box at a time by faceProduct, not by the batches of verifyFaces
+  {
+    Vector normal( faceNormal( face ) );
+    int rows( faceRowCount() );
+    interval ti( interval(i-1, i)/rows );
+    bool first( 1 );
+    violation = FaceViolation();
+    evaluationCount = 0;
+
+    if( refineDepth > 0 )
+    {
+      interval range( rowRange( face, ti ) );
+      for(int j=1; j <= rows; j++)
+        if( !refineFaceProduct( face, normal, ti, range, interval(j-1, j)/rows, refineDepth, hull, first, 1 ) )
+          return 0;
+      return 1;
+    }
+
+    Vector Gamma_i(3), face_i(3);
+    slowPoint( ti, Gamma_i );
+    faceRow( face, ti, face_i );
+    Vector face_ij( face_i );
+
+    for(int j=1; j <= rows; j++)
+    {
+      interval tj( interval(j-1, j)/rows );
+      face_ij[ face < UL ? 1 : 0 ] = faceCellCoordinate( face, face_i, tj );
+      interval product( faceProduct( Gamma_i, face_ij, normal ) );
+      evaluationCount++;
+
+      hull = ( first ? product : intervalHull( hull, product ) );
+      first = 0;
+      if( !hasRequiredSign( face, product ) )
+      {
+        setViolation( face, ti, tj, product );
+        return 0;
       }
     }
+    return 1;
+  }
 
-    return IVector({ NormalULxVectorField, NormalURxVectorField });
+  bool verifyIsolation( bool _entrance = 1, bool _exit = 1 ) // whether the products have the required sign on all boxes of the requested faces,
+                                                             // stops at the first box where they do not (see violation)
+  {
+    verifyFaces( _entrance, _exit, 1 );
+    return violation.face < 0;
+  }
+
+  IVector entranceVerification() // stable faces only, {normalSLxVectorField, normalSRxVectorField}
+  {
+    return verifyFaces(1, 0).entrance();
+  }
+
+  IVector exitVerification() // unstable faces only, {normalULxVectorField, normalURxVectorField}
+  {
+    return verifyFaces(0, 1).exit();
   }
 };
 
 
+#ifdef FHN_STATIC_DIMENSION
+typedef FhnIsolatingSegmentT<3> FhnIsolatingSegment;    // fixed-size vectors and matrices
+#else
+typedef FhnIsolatingSegmentT<0> FhnIsolatingSegment;    // dynamically allocated IVector, IMatrix
+#endif
+
+
 class longIsolatingSegment : public FhnIsolatingSegment
 {
 public:
   IMatrix endP;
+  int threads;                            // number of worker threads verifying subsegments (1 - serial)
+  long newtonIterationCount;              // number of Newton iterations times number of points corrected by the last call of subsegments
 
   longIsolatingSegment( IMap _vectorField, const IVector& _GammaLeft, const IVector& _GammaRight, const IMatrix& _P, const IMatrix& _endP, 
-                        const IVector& _leftFace, const IVector& _rightFace, interval _disc )
+                        const IVector& _leftFace, const IVector& _rightFace, interval _disc, int _threads = 1 )
   : FhnIsolatingSegment( _vectorField, _GammaLeft, _GammaRight, _P, _leftFace, _rightFace, _disc ),
-    endP(_endP)
+    endP(_endP),
+    threads(_threads),
+    newtonIterationCount(0)
   // here we store an end coordinate change to be able to verify the last covering
   {
   }
   
-  IVector Eq_correct(IVector& guess)              // corrects initial guesses of u so they are closer to real equilibria using Newton alg., w is always 0, computes on 
-                                                  // intervals to avoid code repetition - but is not rigorous (! this is not an interval Newton operator !)
+  std::vector<IVector> slowManifoldPoints(int N_Segments) // end points of subsegments 1, ..., N_Segments-1: points of the linear approximation of the slow manifold
+                                                          // at fractions i/N_Segments, with u corrected by Newton's method for all of them at once (see FhnSlowManifoldPoints),
+                                                          // w is always 0
   {
-    interval error(1.);
-    interval result(guess[0]);
-    interval oldresult(result);
-    while(error > accuracy)
+    IVector Left( dynamicVector(GammaLeft) ), Right( dynamicVector(GammaRight) );
+    std::vector<IVector> points( N_Segments > 1 ? N_Segments-1 : 0 );
+    std::vector<double> u( points.size() ), v( points.size() );
+
+    for(size_t k=0; k<points.size(); k++)
+    {
+      points[k] = ( Right - Left )*interval( double(k+1)/double(N_Segments) ) + Left;
+      u[k] = points[k][0].mid().leftBound();
+      v[k] = points[k][2].mid().leftBound();
+    }
+
+    newtonIterationCount = long( FhnSlowManifoldPoints( u, v ) )*points.size();
+
+    for(size_t k=0; k<points.size(); k++)
     {
-      oldresult = result;
-      result = result - (vectorField( IVector(result, 0., guess[2]) )[1])/(vectorField[ IVector(result, 0., guess[2]) ][1][0]);  
-                                                                          // Newton algorithm to calculate zeroes of the vector field - w is always 0.,
-                                                                          // derivative is of the second equation with respect to first variable - u
-      error = abs(oldresult - result);
+      points[k][0] = u[k];
+      points[k][1] = 0.;
     }
-    IVector new_Eq(3);
-    new_Eq[0] = result;
-    new_Eq[1] = interval(0.);
-    new_Eq[2] = guess[2];
-    return new_Eq;
+    return points;
   }
-  
-  IVector entranceAndExitVerification(int N_Segments) // first two coordinates are hulls of normalSLxVectorField, normalSRxVectorField, then normalULxVectorField and normalURxVectorField
-    // exit and entrance verification are done together here to speed up calculations, reduce amount of code and memory used, etc.
-    // N_Segments is the number of subsegments of a long isolating segment; disc is then number of discretizations of each such subsegment
-    // we do not "rotate" subsegments, we also do not need to widen and shorten them to get coverings - we treat them as a part of one long
-    // partially smooth IS
+
+
+  struct Subsegment                       // everything needed to verify one subsegment independently of the others
   {
-    IVector Gamma_i0( GammaLeft );
+    IVector Gamma_i0;
+    IVector Gamma_i1;
+    IVector Face_i0;
+    IVector Face_i0_adj;
+    IVector Face_i1;
+    IMatrix P_i0;
+    IMatrix P_i1;
+    bool checkCovering;                   // the last subsegment arrives at exactly rightFace, there is nothing to cover there
+  };
+
+  std::vector<Subsegment> subsegments(int N_Segments) // serial pass - corrects subsegment end points and computes coordinate changes along the slow manifold
+                                                     // these are cheap compared to the verification and only depend on i, not on the previous subsegments
+  {
+    std::vector<Subsegment> result( N_Segments );
+    std::vector<IVector> points( slowManifoldPoints( N_Segments ) );
+
+    IVector Right( dynamicVector(GammaRight) );   // the geometry of the segment may be stored in fixed-size vectors
+
+    IVector Gamma_i0( dynamicVector(GammaLeft) );
     IVector Gamma_i1(3);
 
-    IVector Face_i0( leftFace );
+    IVector Face_i0( dynamicVector(leftFace) );
     IVector Face_i1(3);
     IVector Face_i0_adj(3); // adjusted Face_i0 (widened in stable direction, shrinked in unstable) so that there are coverings between subsegments
 
-    IMatrix P_i0( P );
+    IMatrix P_i0( dynamicMatrix(P) );
     IMatrix P_i1(3,3);
 
-    // hulls of all normals (unstable, stable, left, right) times vector fields of all subsegments
-    interval NormalULxVectorFieldHull;
-    interval NormalURxVectorFieldHull;   
-
-    interval NormalSLxVectorFieldHull; 
-    interval NormalSRxVectorFieldHull;
-
-
     for(int i=1; i<=N_Segments; i++)
     {
      if( i < N_Segments )
      {
       interval ti1( double(i)/double(N_Segments) );
-      Gamma_i1 = ( GammaRight - GammaLeft )*ti1 + GammaLeft;
-      Gamma_i1 = Eq_correct( Gamma_i1 ); // we correct linear approx. of a slow manifold point by Newtons method
+      Gamma_i1 = points[i-1]; // linear approx. of a slow manifold point corrected by Newtons method
 
       // we widen the faces by linearly extending/contracting width and length from leftFace to rightFace sizes
       Face_i1[0] = interval( ( ( rightFace[0].leftBound() - leftFace[0].leftBound() )*ti1 + leftFace[0].leftBound() ).leftBound(), // remove some leftBounds?
@@ -311,46 +822,109 @@ public:
       P_i1 = coordChange( vectorField, Gamma_i1 ); // we rotate the subsegments
 
       Face_i0_adj = shrinkAndExpand( Face_i0, 1.1 ); // we shrink and expand the face by a fixed constant to get covering between subsegment faces
-
-      if( !isCovering( Face_i0, inverseMatrix(P_i1)*P_i0, Face_i0_adj ) )            // checking whether Face_i0 covers Face_i0_adj by matrix P_i1^(-1)*P_i0 (so changing coordinates
-                                                                                     // from P_i0 to P_i1)
-                                                                                     // this will happen if our partition into subsegments is fine enough
-         throw "NO COVERING BETWEEN SUBSEGMENTS! \n";
      }
      else
      {
-      Gamma_i1 = GammaRight;  // we dont need to shrink and expand here, we will arrive at the exactly same face
-      Face_i1 = rightFace;
+      Gamma_i1 = Right;  // we dont need to shrink and expand here, we will arrive at the exactly same face
+      Face_i1 = dynamicVector(rightFace);
       P_i1 = endP;
      }
-     
-     FhnIsolatingSegment Segment_i( vectorField, Gamma_i0, Gamma_i1, P_i1, Face_i0_adj, Face_i1, disc ); 
-    
-     if( i == 1 )
-     {
-      NormalSLxVectorFieldHull = Segment_i.entranceVerification()[0]; 
-      NormalSRxVectorFieldHull = Segment_i.entranceVerification()[1];
-      NormalULxVectorFieldHull = Segment_i.exitVerification()[0];
-      NormalURxVectorFieldHull = Segment_i.exitVerification()[1];
-     }
-     else
-     {
-      NormalSLxVectorFieldHull = intervalHull( NormalSLxVectorFieldHull, Segment_i.entranceVerification()[0] ); 
-      NormalSRxVectorFieldHull = intervalHull( NormalSRxVectorFieldHull, Segment_i.entranceVerification()[1] );
-      NormalULxVectorFieldHull = intervalHull( NormalULxVectorFieldHull, Segment_i.exitVerification()[0] );
-      NormalURxVectorFieldHull = intervalHull( NormalURxVectorFieldHull, Segment_i.exitVerification()[1] );
-     }
+
+     Subsegment& S( result[i-1] );
+     S.Gamma_i0 = Gamma_i0;
+     S.Gamma_i1 = Gamma_i1;
+     S.Face_i0 = Face_i0;
+     S.Face_i0_adj = Face_i0_adj;
+     S.Face_i1 = Face_i1;
+     S.P_i0 = P_i0;
+     S.P_i1 = P_i1;
+     S.checkCovering = ( i < N_Segments );
 
      Gamma_i0 = Gamma_i1;  // we move to the next subsegment
      Face_i0 = Face_i1;
      P_i0 = P_i1;
     }
 
-    return IVector({ NormalSLxVectorFieldHull, NormalSRxVectorFieldHull, NormalULxVectorFieldHull, NormalURxVectorFieldHull });
+    return result;
   }
   
+  IVector entranceAndExitVerification(int N_Segments, bool _stopOnWrongSign = 0) // first two coordinates are hulls of normalSLxVectorField, normalSRxVectorField, then normalULxVectorField and normalURxVectorField
+    // exit and entrance verification are done together here to speed up calculations, reduce amount of code and memory used, etc.
+    // N_Segments is the number of subsegments of a long isolating segment; disc is then number of discretizations of each such subsegment
+    // we do not "rotate" subsegments, we also do not need to widen and shorten them to get coverings - we treat them as a part of one long
+    // partially smooth IS
+    // subsegments are verified in parallel (see subsegments for the serial part), each worker thread with its own copy of the vector field
+    // with _stopOnWrongSign subsegments stop at the first box without the required sign as in verifyFaces and no further subsegments are started,
+    // the box of the first such subsegment is stored in violation
+  {
+    std::vector<Subsegment> S( subsegments( N_Segments ) );
 
+    std::vector<IVector> results( N_Segments, IVector(4) );   // normalSL, normalSR, normalUL, normalUR times the vector field for each subsegment
+    std::vector<long> evaluations( N_Segments, 0 );           // subsegments skipped after a violation keep zero products, which do not have the required sign
+    std::atomic<bool> stopped( false );
+    std::mutex violationMutex;
+    violation = FaceViolation();
+    int workerCount( threads < N_Segments ? threads : N_Segments );
+    std::vector<IMap> maps( workerCount > 1 ? workerCount : 1, vectorField );
 
-};
+    parallelFor( N_Segments, workerCount, [&]( int w, int i )
+    {
+      if( stopped )
+        return;
+
+      if( S[i].checkCovering && !isCovering( S[i].Face_i0, inverseMatrix(S[i].P_i1)*S[i].P_i0, S[i].Face_i0_adj ) )   
+                                                                                     // checking whether Face_i0 covers Face_i0_adj by matrix P_i1^(-1)*P_i0 (so changing coordinates
+                                                                                     // from P_i0 to P_i1)
+                                                                                     // this will happen if our partition into subsegments is fine enough
+        throw "NO COVERING BETWEEN SUBSEGMENTS! \n";
+
+      if( S[i].checkCovering && certificate.writer )
+      {
+        std::ostringstream line;        // in the format of the geometry file of certificates (see certificate.hpp)
+        line.precision(17);
+        line << "covering " << certificate.run << " " << certificate.stage << " " << i;
+        FhnWriteVector( line, S[i].Face_i0 );
+        FhnWriteMatrix( line, S[i].P_i0 );
+        FhnWriteMatrix( line, S[i].P_i1 );
+        FhnWriteVector( line, S[i].Face_i0_adj );
+        certificate.writer->writeGeometry( line.str() );
+      }
+
+      FhnIsolatingSegment Segment_i( maps[w], S[i].Gamma_i0, S[i].Gamma_i1, S[i].P_i1, S[i].Face_i0_adj, S[i].Face_i1, disc ); 
+
+      Segment_i.refineDepth = refineDepth;
+      Segment_i.checkpoint = checkpoint;  // subsegments verified by an interrupted run are not verified again
+      Segment_i.certificate = FhnCertificateStream( certificate.writer, certificate.run, certificate.stage, i );
+
+      FaceVerification faces( Segment_i.verifyAllFaces( _stopOnWrongSign ) );
+      results[i] = IVector({ faces.product[SL], faces.product[SR], faces.product[UL], faces.product[UR] });
+      evaluations[i] = Segment_i.evaluationCount;
 
+      if( Segment_i.violation.face >= 0 )
+      {
+        std::lock_guard<std::mutex> lock( violationMutex );
+        if( violation.face < 0 || i < violation.subsegment )
+        {
+          violation = Segment_i.violation;
+          violation.subsegment = i;
+        }
+        stopped = true;
+      }
+    } );
 
+    evaluationCount = 0;
+    for(int i=0; i<N_Segments; i++)
+      evaluationCount += evaluations[i];
+
+    // hulls of all normals (unstable, stable, left, right) times vector fields of all subsegments, taken in order of subsegments
+    IVector hulls( results[0] );
+    for(int i=1; i<N_Segments; i++)
+      for(int k=0; k<4; k++)
+        hulls[k] = intervalHull( hulls[k], results[i][k] );
+
+    return hulls;
+  }
+  
+
+
+};
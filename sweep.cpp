@@ -0,0 +1,400 @@
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include "fhn.hpp"
+
+
+// ---------------------------------------------------------------------------------
+// --------------------------- PARAMETER SWEEPS ------------------------------------
+// ---------------------------------------------------------------------------------
+
+// Verifies existence of periodic orbits on many (theta, eps) parameter boxes, given either as a grid or in a file,
+// with several boxes verified concurrently. The vector fields are parsed once (fhn.hpp) and copied for each box.
+// For each box one line is written: box number, bisection depth, its bounds, verified/failed, the failed check, the first face box
+// of wrong sign (if an isolation check failed), the result of the midsection test map and wall time in seconds; the verifications
+// themselves write nothing, as boxes finish concurrently. Optionally the instrumentation report of each box (see instrument.hpp)
+// is written as a line of JSON to another file, all checked enclosures are written to a certificate (see certificate.hpp)
+// and finished stages of all boxes are checkpointed, so that a restarted sweep skips them (see checkpoint.hpp).
+// Optionally boxes which fail are bisected in theta and/or eps and the halves are verified again, up to a given depth;
+// the union of all verified (sub)boxes is the result of the sweep.
+// Corner points of verified boxes are remembered to start the corrections for boxes of nearby theta from (--corner-cache), so which
+// neighbours a box starts from, and in rare cases whether it verifies, may depend on the order in which concurrent boxes finish.
+
+struct FhnParameterBox
+{
+  interval theta;
+  interval eps;
+};
+
+struct FhnSweepItem               // a box to verify, numbered by the original box and the bisections leading to it, e.g. 3/0/1
+{
+  FhnParameterBox box;
+  std::string id;
+  int original;                   // number of the original box
+  int depth;                      // number of bisections
+  double fraction;                // fraction of the original box (by area)
+};
+
+struct FhnSweepSettings
+{
+  int workers;                  // boxes verified concurrently (0 - all available cores)
+  int threadsPerBox;            // threads used inside each verification
+  int pMapDivCount;             // discretization parameters passed on to FhnVerifyExistenceOfPeriodicOrbit
+  int longSubsegmentCount;
+  int longSegmentDivCount;
+  int cornerSegmentDivCount;
+  int pMapCellBudget;           // adaptive subdivision of sets integrated by Poincare maps (0 - uniform grid)
+  double pMapCellTolerance;     // width up to which the adaptive subdivision refines cells of whole sets (0 - only edges are refined)
+  int faceRefineDepth;          // adaptive refinement of segment faces (0 - uniform grids)
+  int cornerCacheSize;          // theta values whose corner points are remembered to start corrections for nearby theta from (0 - no continuation)
+  int bisectDepth;              // how many times failed boxes are bisected (0 - never)
+  bool bisectTheta;             // directions in which failed boxes are bisected
+  bool bisectEps;
+};
+
+bool parseRange( const char* text, double& lo, double& hi, int& count ) // LO:HI:N
+{
+  char* end;
+  lo = std::strtod( text, &end );
+  if( *end != ':' )
+    return 0;
+  hi = std::strtod( end + 1, &end );
+  if( *end != ':' )
+    return 0;
+  count = std::strtol( end + 1, &end, 10 );
+  return ( *end == 0 && count > 0 && lo <= hi );
+}
+
+std::vector<interval> slabs( double lo, double hi, int count ) // [lo,hi] split into count intervals, neighbouring slabs share exactly the same end points
+{
+  std::vector<double> edges( count + 1 );
+  for( int k = 0; k <= count; k++ )
+    edges[k] = ( k == count ? hi : lo + ( hi - lo )*k/count );
+
+  std::vector<interval> result;
+  for( int k = 0; k < count; k++ )
+    result.push_back( interval( edges[k], edges[k+1] ) );
+  return result;
+}
+
+bool readBoxes( const char* fileName, std::vector<FhnParameterBox>& boxes ) // lines "thetaLo thetaHi epsLo epsHi", # starts a comment
+{
+  std::ifstream file( fileName );
+  if( !file )
+    return 0;
+
+  std::string line;
+  while( std::getline( file, line ) )
+  {
+    if( line.empty() || line[0] == '#' )
+      continue;
+
+    std::istringstream words( line );
+    double thetaLo, thetaHi, epsLo, epsHi;
+    if( !( words >> thetaLo >> thetaHi >> epsLo >> epsHi ) || thetaLo > thetaHi || epsLo > epsHi )
+      return 0;
+
+    FhnParameterBox box = { interval( thetaLo, thetaHi ), interval( epsLo, epsHi ) };
+    boxes.push_back( box );
+  }
+  return 1;
+}
+
+std::string csvMessage( std::string message ) // failure messages of the proof end with "! \n", we keep them on one line
+{
+  while( !message.empty() && ( message[message.size()-1] == '\n' || message[message.size()-1] == ' ' ) )
+    message.erase( message.size()-1 );
+  for( size_t k = 0; k < message.size(); k++ )
+    if( message[k] == '"' || message[k] == '\n' )
+      message[k] = '\'';
+  return "\"" + message + "\"";
+}
+
+std::string boxBounds( const FhnParameterBox& box, const char* separator )
+{
+  char bounds[128];
+  std::snprintf( bounds, sizeof(bounds), "%.17g%s%.17g%s%.17g%s%.17g", box.theta.leftBound(), separator, box.theta.rightBound(), separator, 
+                                                                        box.eps.leftBound(), separator, box.eps.rightBound() );
+  return bounds;
+}
+
+std::string csvLine( const FhnSweepItem& item, const FhnVerificationResult& result )
+{
+  std::ostringstream line;
+  line << item.id << "," << item.depth << "," << boxBounds( item.box, "," ) << "," << ( result.verified ? "verified" : "failed" ) << "," 
+       << csvMessage( result.failedCheck ) << "," << result.failedLocation << "," << result.midsectionCovering << "," << result.wallTime;
+  return line.str();
+}
+
+std::string jsonLine( const FhnSweepItem& item, const FhnVerificationResult& result )
+{
+  std::ostringstream line;
+  line << "{\"box\":\"" << item.id << "\",\"bounds\":[" << boxBounds( item.box, "," ) << "],\"verified\":" << ( result.verified ? "true" : "false" )
+       << ",\"seconds\":" << result.wallTime << ",\"report\":" << result.report << "}";
+  return line.str();
+}
+
+std::vector<interval> halves( const interval& x, bool bisect )  // both halves of x, or just x if it is not to be (or cannot be) bisected
+{
+  std::vector<interval> result;
+  double mid( 0.5*x.leftBound() + 0.5*x.rightBound() );
+
+  if( bisect && mid > x.leftBound() && mid < x.rightBound() )
+  {
+    result.push_back( interval( x.leftBound(), mid ) );
+    result.push_back( interval( mid, x.rightBound() ) );
+  }
+  else
+    result.push_back( x );
+  return result;
+}
+
+std::vector<FhnSweepItem> FhnSweep( const std::vector<FhnParameterBox>& boxes, const FhnSweepSettings& settings, std::ostream& output, 
+                                    FhnPreprocessingCache* preprocessingCache, std::ostream* report, FhnCheckpoint* checkpoint, FhnCertificateWriter* certificate ) 
+  // returns verified (sub)boxes, report - instrumentation reports (0 - none), checkpoint - finished stages of an interrupted sweep (0 - none),
+  // certificate - checked enclosures of all boxes (0 - none)
+{
+  std::mutex outputMutex;
+  std::vector<FhnSweepItem> verified;
+  FhnCornerCache cornerCache( settings.cornerCacheSize );
+
+  FhnProofSettings proofSettings;
+  proofSettings.threadCount = settings.threadsPerBox;
+  proofSettings.pMapCellBudget = settings.pMapCellBudget;
+  proofSettings.pMapCellTolerance = settings.pMapCellTolerance;
+  proofSettings.faceRefineDepth = settings.faceRefineDepth;
+  proofSettings.cornerCache = ( settings.cornerCacheSize > 0 ? &cornerCache : 0 );
+  proofSettings.preprocessingCache = preprocessingCache;
+  proofSettings.checkpoint = checkpoint;
+  proofSettings.certificate = certificate;
+  proofSettings.instrument = ( report != 0 );
+  proofSettings.quiet = 1;        // boxes finish concurrently, their messages are in the CSV
+
+  std::vector<FhnSweepItem> items;
+  for( size_t k = 0; k < boxes.size(); k++ )
+  {
+    FhnSweepItem item = { boxes[k], std::to_string( k ), int(k), 0, 1. };
+    items.push_back( item );
+  }
+
+  output << "box,depth,theta_lo,theta_hi,eps_lo,eps_hi,result,failed_check,failed_location,midsection_covering,seconds\n" << std::flush;
+
+  parallelWorkQueue( items, threadCount( settings.workers ), [&]( int, const FhnSweepItem& item, WorkQueue<FhnSweepItem>& queue )
+  {
+    FhnVerificationResult result( FhnVerifyExistenceOfPeriodicOrbit( item.box.theta, item.box.eps, 0, 1, settings.pMapDivCount, settings.longSubsegmentCount,
+                                                                      settings.longSegmentDivCount, settings.cornerSegmentDivCount, proofSettings ) );
+    {
+      std::lock_guard<std::mutex> lock( outputMutex );
+      output << csvLine( item, result ) << "\n" << std::flush;   // lines are written as boxes finish, so an interrupted sweep keeps its results
+      if( report )
+        *report << jsonLine( item, result ) << "\n" << std::flush;
+      if( result.verified )
+        verified.push_back( item );
+    }
+
+    if( !result.verified && item.depth < settings.bisectDepth )    // halves are verified in parallel by other workers
+    {
+      std::vector<interval> thetas( halves( item.box.theta, settings.bisectTheta ) );
+      std::vector<interval> epss( halves( item.box.eps, settings.bisectEps ) );
+
+      if( thetas.size()*epss.size() > 1 )
+        for( size_t i = 0; i < thetas.size(); i++ )
+          for( size_t j = 0; j < epss.size(); j++ )
+          {
+            FhnSweepItem half = { { thetas[i], epss[j] }, item.id + "/" + std::to_string( i*epss.size() + j ), item.original, item.depth + 1, 
+                                   item.fraction/( thetas.size()*epss.size() ) };
+            queue.push( half );
+          }
+    }
+  } );
+
+  return verified;
+}
+
+
+// ---------------------------------------------------------------------------------
+// ----------------------------------- MAIN ----------------------------------------
+// ---------------------------------------------------------------------------------
+
+const char* usage =
+  "usage: sweep [options]\n"
+  "  --theta LO:HI:N     theta range split into N slabs (default 0.61:0.61:1)\n"
+  "  --eps LO:HI:N       eps range split into N slabs (default 0:1e-6:1)\n"
+  "  --boxes FILE        boxes from a file instead, lines \"thetaLo thetaHi epsLo epsHi\"\n"
+  "  --output FILE       results in CSV format (default sweep.csv)\n"
+  "  --workers N         boxes verified concurrently (default 0 - all cores)\n"
+  "  --threads N         threads used inside each verification (default 1)\n"
+  "  --pmap-div N        subdivisions of sets integrated by Poincare maps (default 20)\n"
+  "  --pmap-budget N     refine the --pmap-div grid adaptively up to N cells (default 0 - uniform grid): cells of edges\n"
+  "                      until their images decide the coverings, cells of whole sets while wider than --pmap-tolerance\n"
+  "  --pmap-tolerance X  width of images of cells of whole sets up to which they are refined (default 0 - not refined)\n"
+  "  --subsegments N     subsegments of long segments (default 100)\n"
+  "  --long-div N        subdivisions of faces of long subsegments (default 80)\n"
+  "  --corner-div N      subdivisions of faces of corner segments (default 200)\n"
+  "  --face-refine N     start faces from grids 2^N times coarser and bisect boxes of unknown sign up to N times (default 0 - uniform grids)\n"
+  "  --corner-cache N    remember corner points of N theta values to continue from (default 16, 0 - always start from the original guesses)\n"
+  "  --bisect-depth N    bisect failed boxes and verify the halves, at most N times (default 0)\n"
+  "  --bisect-in DIR     directions of bisections: theta, eps or both (default both)\n"
+  "  --cache FILE        persistent cache of corner points and coordinate changes (default fhn.cache, \"\" - none)\n"
+  "  --checkpoint FILE   finished stages of all boxes, a restarted sweep skips them (default none)\n"
+  "  --certificate FILE  all checked enclosures of all boxes in binary, to be checked by fhn-cert, and the geometry\n"
+  "                      of all segments in FILE.geometry, to be verified again by fhn-check (default none)\n"
+  "  --report FILE       counters and stage times of each box, one line of JSON per box (default none)\n"
+  "  --union FILE        verified (sub)boxes in the format of --boxes (default sweep-union.txt)\n";
+
+int main( int argc, char* argv[] ){
+
+  cout.precision(9);
+
+  double thetaLo( 0.61 ), thetaHi( 0.61 ), epsLo( 0. ), epsHi( 1e-6 );
+  int thetaCount( 1 ), epsCount( 1 );
+  const char* boxesFile( 0 );
+  const char* outputFile( "sweep.csv" );
+  const char* unionFile( "sweep-union.txt" );
+  const char* cacheFile( "fhn.cache" );
+  const char* reportFile( 0 );
+  const char* checkpointFile( 0 );
+  const char* certificateFile( 0 );
+  FhnSweepSettings settings = { 0, 1, 20, 100, 80, 200, 0, 0., 0, 16, 0, 1, 1 };
+
+  for( int k = 1; k < argc; k++ )
+  {
+    bool hasValue( k + 1 < argc );
+    bool ok( hasValue );
+
+    if( !std::strcmp( argv[k], "--theta" ) && hasValue )
+      ok = parseRange( argv[++k], thetaLo, thetaHi, thetaCount );
+    else if( !std::strcmp( argv[k], "--eps" ) && hasValue )
+      ok = parseRange( argv[++k], epsLo, epsHi, epsCount );
+    else if( !std::strcmp( argv[k], "--boxes" ) && hasValue )
+      boxesFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--output" ) && hasValue )
+      outputFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--workers" ) && hasValue )
+      settings.workers = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--threads" ) && hasValue )
+      settings.threadsPerBox = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--pmap-div" ) && hasValue )
+      settings.pMapDivCount = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--pmap-budget" ) && hasValue )
+      settings.pMapCellBudget = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--pmap-tolerance" ) && hasValue )
+      settings.pMapCellTolerance = std::atof( argv[++k] );
+    else if( !std::strcmp( argv[k], "--subsegments" ) && hasValue )
+      settings.longSubsegmentCount = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--long-div" ) && hasValue )
+      settings.longSegmentDivCount = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--corner-div" ) && hasValue )
+      settings.cornerSegmentDivCount = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--face-refine" ) && hasValue )
+      settings.faceRefineDepth = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--corner-cache" ) && hasValue )
+      settings.cornerCacheSize = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--cache" ) && hasValue )
+      cacheFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--checkpoint" ) && hasValue )
+      checkpointFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--certificate" ) && hasValue )
+      certificateFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--report" ) && hasValue )
+      reportFile = argv[++k];
+    else if( !std::strcmp( argv[k], "--bisect-depth" ) && hasValue )
+      settings.bisectDepth = std::atoi( argv[++k] );
+    else if( !std::strcmp( argv[k], "--bisect-in" ) && hasValue )
+    {
+      k++;
+      settings.bisectTheta = ( !std::strcmp( argv[k], "theta" ) || !std::strcmp( argv[k], "both" ) );
+      settings.bisectEps = ( !std::strcmp( argv[k], "eps" ) || !std::strcmp( argv[k], "both" ) );
+      ok = ( settings.bisectTheta || settings.bisectEps );
+    }
+    else if( !std::strcmp( argv[k], "--union" ) && hasValue )
+      unionFile = argv[++k];
+    else
+      ok = 0;
+
+    if( !ok )
+    {
+      std::cerr << usage;
+      return 1;
+    }
+  }
+
+  std::vector<FhnParameterBox> boxes;
+
+  if( boxesFile )
+  {
+    if( !readBoxes( boxesFile, boxes ) )
+    {
+      std::cerr << "Cannot read parameter boxes from " << boxesFile << "\n";
+      return 1;
+    }
+  }
+  else
+  {
+    std::vector<interval> thetas( slabs( thetaLo, thetaHi, thetaCount ) );
+    std::vector<interval> epss( slabs( epsLo, epsHi, epsCount ) );
+
+    for( size_t i = 0; i < thetas.size(); i++ )
+      for( size_t j = 0; j < epss.size(); j++ )
+      {
+        FhnParameterBox box = { thetas[i], epss[j] };
+        boxes.push_back( box );
+      }
+  }
+
+  std::ofstream output( outputFile );
+  if( !output )
+  {
+    std::cerr << "Cannot write to " << outputFile << "\n";
+    return 1;
+  }
+  output.precision(17);
+
+  std::unique_ptr<std::ofstream> report( reportFile ? new std::ofstream( reportFile ) : 0 );
+  if( report && !*report )
+  {
+    std::cerr << "Cannot write to " << reportFile << "\n";
+    return 1;
+  }
+  if( report )
+    report->precision(17);
+
+  std::unique_ptr<FhnPreprocessingCache> preprocessingCache( *cacheFile ? new FhnPreprocessingCache( cacheFile ) : 0 );
+  std::unique_ptr<FhnCheckpoint> checkpoint( checkpointFile ? new FhnCheckpoint( checkpointFile ) : 0 );
+  std::unique_ptr<FhnCertificateWriter> certificate;
+  if( certificateFile )
+  {
+    try
+    {
+      certificate.reset( new FhnCertificateWriter( certificateFile ) );
+    }
+    catch(const char*)
+    {
+      std::cerr << "Cannot write to " << certificateFile << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<FhnSweepItem> verified( FhnSweep( boxes, settings, output, preprocessingCache.get(), report.get(), checkpoint.get(), certificate.get() ) );
+
+  std::ofstream unionOutput( unionFile );
+  unionOutput << "# verified (sub)boxes: thetaLo thetaHi epsLo epsHi\n";
+  std::vector<double> verifiedFraction( boxes.size(), 0. );
+  std::vector<int> verifiedCount( boxes.size(), 0 );
+
+  for( size_t k = 0; k < verified.size(); k++ )
+  {
+    unionOutput << boxBounds( verified[k].box, " " ) << "\n";
+    verifiedFraction[ verified[k].original ] += verified[k].fraction;
+    verifiedCount[ verified[k].original ]++;
+  }
+
+  for( size_t k = 0; k < boxes.size(); k++ )
+    cout << "Box " << k << " theta=" << boxes[k].theta << " eps=" << boxes[k].eps << ": fraction " << verifiedFraction[k] << " verified in " 
+         << verifiedCount[k] << " (sub)boxes \n";
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* -----------------------------------------------------------------------------------------
+ * This is a header file to fhn.cpp providing a hand-written FitzHugh-Nagumo vector field
+ * and its Jacobian, templated on the scalar type (interval or double). It evaluates the same
+ * formula as Fhn_vf without interpreting the expression tree of an IMap, which matters
+ * in the face sweeps of isolating segments where it is evaluated on millions of small boxes.
+ * If the full FitzHugh-Nagumo vector field in fhn.cpp is changed in any other way than changing
+ * parameters theta or eps, one needs to manually readjust this class as well
+ * (FhnVectorFieldSelfTest, which every verification runs first, checks the agreement with the IMap).
+ * ----------------------------------------------------------------------------------------*/
+
+#include <cstdlib>
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- VECTOR FIELD ------------------------------------------ */
+/* ------------------------------------------------------------------------------------ */
+
+template<typename T>
+class FhnVectorField     // u'=w, w'=0.2*(theta*w +u*(u-1)*(u-0.1)+v), v'= eps/theta * (u-v), variables are x = (u,w,v)
+{
+public:
+  T theta;
+  T eps;
+  T c2;                  // 2/10
+  T c1;                  // 1/10
+  T epsOverTheta;
+
+  FhnVectorField( const T& _theta, const T& _eps )
+    : theta( _theta ),
+      eps( _eps ),
+      c2( T(2.)/T(10.) ),    // for intervals these are enclosures of 0.2 and 0.1, as in the IMap
+      c1( T(1.)/T(10.) ),
+      epsOverTheta( _eps/_theta )
+  {
+  }
+
+  void operator()( const T x[3], T f[3] ) const
+  {
+    f[0] = x[1];
+    f[1] = c2*( theta*x[1] + x[0]*( x[0] - T(1.) )*( x[0] - c1 ) + x[2] );
+    f[2] = epsOverTheta*( x[0] - x[2] );
+  }
+
+  void jacobian( const T x[3], T J[3][3] ) const   // J[i][j] = df_i/dx_j
+  {
+    J[0][0] = T(0.);
+    J[0][1] = T(1.);
+    J[0][2] = T(0.);
+
+    J[1][0] = c2*( ( x[0] - T(1.) )*( x[0] - c1 ) + x[0]*( x[0] - c1 ) + x[0]*( x[0] - T(1.) ) );  // derivative of the cubic by the product rule
+    J[1][1] = c2*theta;
+    J[1][2] = c2;
+
+    J[2][0] = epsOverTheta;
+    J[2][1] = T(0.);
+    J[2][2] = -epsOverTheta;
+  }
+};
+
+typedef FhnVectorField<interval> IFhnVectorField;
+typedef FhnVectorField<double> DFhnVectorField;
+
+
+/* ------------------------------------------------------------------------------------ */
+/* ---------------------------- SELF-TEST --------------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+
+bool FhnVectorFieldSelfTest( IMap _vectorField, int _samples = 1000 )  // checks on pseudorandom boxes that the kernel enclosures of the vector field and its Jacobian
+                                                                      // on a box intersect the IMap enclosures on the same box (both enclose the same set) and contain
+                                                                      // the IMap enclosures at the vertices and other points of the box, _vectorField is a 3d field
+                                                                      // with parameters theta and eps set (like Fhn_vf)
+{
+  IFhnVectorField kernel( _vectorField.getParameter("theta"), _vectorField.getParameter("eps") );
+  std::srand( 1 );
+
+  for( int k = 0; k < _samples; k++ )
+  {
+    double center[3] = { -0.5 + 1.7*std::rand()/RAND_MAX, -0.3 + 0.6*std::rand()/RAND_MAX, -0.1 + 0.3*std::rand()/RAND_MAX };  // u, w, v ranges of the proof
+    double radius( 1e-6 + 1e-2*std::rand()/RAND_MAX );
+
+    interval X[3];
+    for( int i = 0; i < 3; i++ )
+      X[i] = center[i] + radius*interval(-1.,1.);
+
+    interval f[3];
+    interval J[3][3];
+    kernel( X, f );
+    kernel.jacobian( X, J );
+
+    IVector box( X[0], X[1], X[2] );
+    IVector fBox( _vectorField( box ) );
+    IMatrix JBox( _vectorField[ box ] );
+    interval common;
+
+    for( int i = 0; i < 3; i++ )
+    {
+      if( !intersection( fBox[i], f[i], common ) )
+        return 0;
+      for( int j = 0; j < 3; j++ )
+        if( !intersection( JBox[i][j], J[i][j], common ) )
+          return 0;
+    }
+
+    for( int p = 0; p < 27; p++ )   // the 3 x 3 x 3 grid of the box, i.e. its vertices, midpoints of its edges and faces and its center
+    {
+      double s[3] = { double( p % 3 - 1 ), double( p / 3 % 3 - 1 ), double( p / 9 - 1 ) };
+      IVector x( center[0] + s[0]*radius, center[1] + s[1]*radius, center[2] + s[2]*radius );
+
+      IVector fIMap( _vectorField( x ) );
+      IMatrix JIMap( _vectorField[ x ] );
+
+      for( int i = 0; i < 3; i++ )
+      {
+        if( !subset( fIMap[i], f[i] ) )
+          return 0;
+        for( int j = 0; j < 3; j++ )
+          if( !subset( JIMap[i][j], J[i][j] ) )
+            return 0;
+      }
+    }
+  }
+  return 1;
+}